@@ -29,6 +29,36 @@ function API(agent, appmetrics) {
   this.initialized = 2;
   var that = this;
 
+  // While decoding history, events are collected here instead of emitted
+  var sink = null;
+  var publish = function(topic, data) {
+    if (sink) {
+      sink.push({ topic: topic, data: data });
+    } else {
+      that.emit(topic, data);
+    }
+  };
+
+  /*
+   * Parses the records from agent.readHistory() into the events they would
+   * have raised, [{time, topic, data}] where time is when the data arrived.
+   */
+  this.decodeHistory = function(records) {
+    var events = [];
+    records.forEach(function(record) {
+      sink = [];
+      try {
+        raiseEvent(record.topic, record.data);
+        sink.forEach(function(event) {
+          events.push({ time: record.time, topic: event.topic, data: event.data });
+        });
+      } finally {
+        sink = null;
+      }
+    });
+    return events;
+  };
+
   var raiseEvent = function(topic, message) {
     if (typeof topic != 'string' || typeof message != 'string') {
       return;
@@ -55,12 +85,24 @@ function API(agent, appmetrics) {
       case 'profiling_node':
         formatProfiling(message);
         break;
+      case 'allocation_node':
+        formatAllocation(message);
+        break;
       case 'api':
         formatApi(message);
         break;
       case 'loop_node':
         formatLoop(message);
         break;
+      case 'threadcpu_node':
+        formatThreadCPU(message);
+        break;
+      case 'rollup':
+        formatRollup(message);
+        break;
+      case 'http_summary':
+        formatHttpSummary(message);
+        break;
       default:
         // Just raise any unknown message as an event so someone can parse it themselves
         that.emit(topic, message);
@@ -75,7 +117,7 @@ function API(agent, appmetrics) {
       process: parseFloat(values[2]),
       system: parseFloat(values[3]),
     };
-    that.emit('cpu', cpu);
+    publish('cpu', cpu);
   };
 
   var formatOSEnv = function(message) {
@@ -134,11 +176,23 @@ function API(agent, appmetrics) {
     if (that.initialized == 0) that.emit('initialized');
   };
 
+  // Additional fields reported by the Linux memory plugin
+  var extraMemoryFields = {
+    pss: 'pss',
+    anon: 'anon',
+    file: 'file',
+    shmem: 'shmem',
+    hosttotalmemory: 'host_total',
+    cgrouplimit: 'cgroup_limit',
+    cgroupusage: 'cgroup_usage',
+  };
+
   var formatMemory = function(message) {
     /*
          * MemorySource,1415976582652,totalphysicalmemory=16725618688,physicalmemory=52428800,privatememory=374747136,virtualmemory=374747136,freephysicalmemory=1591525376
+         * optionally followed by ,pss=...,anon=...,file=...,shmem=...,hosttotalmemory=...,cgrouplimit=...,cgroupusage=...
          */
-    var values = message.split(/[,=]+/);
+    var values = message.trim().split(/[,=]+/);
     var physicalTotal = parseInt(values[3]);
     var physicalFree = parseInt(values[11]);
     var physicalUsed = physicalTotal >= 0 && physicalFree >= 0 ? physicalTotal - physicalFree : -1;
@@ -151,7 +205,11 @@ function API(agent, appmetrics) {
       virtual: parseInt(values[9]),
       physical_free: physicalFree,
     };
-    that.emit('memory', memory);
+    for (var i = 12; i + 1 < values.length; i += 2) {
+      var field = extraMemoryFields[values[i]];
+      if (field) memory[field] = parseInt(values[i + 1]);
+    }
+    publish('memory', memory);
   };
 
   var formatGC = function(message) {
@@ -173,7 +231,7 @@ function API(agent, appmetrics) {
         used: parseInt(values[4]),
         duration: parseInt(values[5]),
       };
-      that.emit('gc', gc);
+      publish('gc', gc);
     });
   };
 
@@ -205,14 +263,116 @@ function API(agent, appmetrics) {
     }
   };
 
+  var formatAllocation = function(message) {
+    /* allocation_node: NodeAllocData,Start,time
+     *                  NodeAllocData,Node,id,parentId,script,function,line,selfSize,totalSize,count
+     *                  NodeAllocData,End
+     */
+    var lines = message.trim().split('\n');
+    var alloc = {
+      time: 0,
+      sites: [],
+    };
+    lines.forEach(function(line) {
+      var values = line.split(',');
+      if (values[1] == 'Node') {
+        alloc.sites.push({
+          self: parseInt(values[2]),
+          parent: parseInt(values[3]),
+          file: values[4],
+          name: values[5],
+          line: parseInt(values[6]),
+          selfSize: parseInt(values[7]),
+          totalSize: parseInt(values[8]),
+          count: parseInt(values[9]),
+        });
+      } else if (values[1] == 'Start') {
+        alloc.time = parseInt(values[2]);
+      }
+    });
+    that.emit('allocation', alloc);
+  };
+
+  var formatThreadCPU = function(message) {
+    /* threadcpu_node: NodeThreadCPUData,time,name,threads,user,system
+     * one line for the whole process, named (process) and followed by the CPUs
+     * available to it, then one per group of threads
+     */
+    var lines = message.trim().split('\n');
+    var cpu = {
+      time: 0,
+      process: null,
+      threads: [],
+    };
+    lines.forEach(function(line) {
+      var values = line.split(',');
+      if (values[0] != 'NodeThreadCPUData') return;
+      var entry = {
+        name: values[2],
+        count: parseInt(values[3]),
+        user: parseFloat(values[4]),
+        system: parseFloat(values[5]),
+      };
+      cpu.time = parseInt(values[1]);
+      if (entry.name == '(process)') {
+        cpu.process = { user: entry.user, system: entry.system };
+        if (values.length > 6) cpu.cpus = parseFloat(values[6]);
+      } else {
+        cpu.threads.push(entry);
+      }
+    });
+    that.emit('cpu-threads', cpu);
+  };
+
+  var parseHistogram = function(value) {
+    // count;sum;min;max;le:n;...;inf:n
+    var parts = value.split(';');
+    var count = parseInt(parts[0]);
+    var histogram = {
+      count: count,
+      minimum: parseFloat(parts[2]),
+      maximum: parseFloat(parts[3]),
+      average: count > 0 ? parseFloat(parts[1]) / count : 0,
+      buckets: [],
+    };
+    for (var i = 4; i < parts.length; i++) {
+      var bucket = parts[i].split(':');
+      histogram.buckets.push({
+        le: bucket[0] === 'inf' ? Infinity : parseFloat(bucket[0]),
+        count: parseInt(bucket[1]),
+      });
+    }
+    return histogram;
+  };
+
+  var formatThreadpool = function(values) {
+    /* NodeThreadpoolData,size,activeAvg,activeMax,stalled,queueHistogram,completionHistogram */
+    var threadpool = {
+      time: Date.now(),
+      size: parseInt(values[1]),
+      active: {
+        average: parseFloat(values[2]),
+        maximum: parseInt(values[3]),
+      },
+      stalled: parseInt(values[4]),
+      queue: parseHistogram(values[5]),
+      completion: parseHistogram(values[6]),
+    };
+    publish('threadpool', threadpool);
+  };
+
   var formatLoop = function(message) {
     /* loop_node: NodeLoopData,min,max,num,sum
-    *
+    *             NodeThreadpoolData,...
     */
     var lines = message.trim().split('\n');
     /* Split each line into the comma-separated values. */
     lines.forEach(function(line) {
       var values = line.split(/[,]+/);
+      if (values[0] === 'NodeThreadpoolData') {
+        formatThreadpool(values);
+        return;
+      }
       var loop = {
         minimum: parseFloat(values[1]),
         maximum: parseFloat(values[2]),
@@ -221,7 +381,39 @@ function API(agent, appmetrics) {
         cpu_user: parseFloat(values[5]),
         cpu_system: parseFloat(values[6]),
       };
-      that.emit('loop', loop);
+      publish('loop', loop);
+    });
+  };
+
+  var formatRollup = function(message) {
+    /* rollup: RollupData,metric,window,start,count;sum;min;max;le:n;...;inf:n */
+    var lines = message.trim().split('\n');
+    lines.forEach(function(line) {
+      var values = line.split(',');
+      var rollup = parseHistogram(values[4]);
+      rollup.metric = values[1];
+      rollup.window = parseInt(values[2]);
+      rollup.time = parseInt(values[3]);
+      publish('rollup', rollup);
+    });
+  };
+
+  var formatHttpSummary = function(message) {
+    /* http_summary: HttpSummaryData,start,interval,method,status:n;...,count;sum;min;max;le:n;...;inf:n,url */
+    var lines = message.trim().split('\n');
+    lines.forEach(function(line) {
+      var values = line.split(',');
+      var summary = parseHistogram(values[5]);
+      summary.time = parseInt(values[1]);
+      summary.interval = parseInt(values[2]);
+      summary.method = values[3];
+      summary.url = values.slice(6).join(',');
+      summary.statusCodes = {};
+      values[4].split(';').forEach(function(status) {
+        var parts = status.split(':');
+        summary.statusCodes[parts[0]] = parseInt(parts[1]);
+      });
+      publish('http-summary', summary);
     });
   };
 
@@ -231,7 +423,7 @@ function API(agent, appmetrics) {
       var parts = line.split(/:(.+)/);
       var topic = parts[0];
       var data = serializer.deserialize(parts[1]);
-      that.emit(topic, data);
+      publish(topic, data);
     });
   };
 
@@ -242,7 +434,6 @@ function API(agent, appmetrics) {
     }
     raiseEvent(topic, data.toString());
   });
-  //    agent.sendControlCommand("history", "");
 }
 module.exports.getAPI = function(agent, appmetrics) {
   return new API(agent, appmetrics);
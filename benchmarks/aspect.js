@@ -0,0 +1,139 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+'use strict';
+
+/*
+ * Per-call overhead of the lib/aspect.js wrappers on driver style methods.
+ *
+ *   node benchmarks/aspect.js [iterations]
+ *
+ * Each case is timed unpatched and patched, and the difference per call is
+ * reported in nanoseconds.
+ */
+
+var aspect = require('../lib/aspect.js');
+
+var iterations = parseInt(process.argv[2], 10) || 5000000;
+
+function noop() {}
+
+// Modelled on redis' RedisClient.prototype.internal_send_command
+function RedisClient() {
+  this.commands = 0;
+}
+RedisClient.prototype.send_command = function(command, args, callback) {
+  this.commands++;
+  if (callback) callback(null, 'OK');
+  return true;
+};
+
+// Modelled on mongodb's Collection.prototype.find/insert
+function Collection() {
+  this.ops = 0;
+}
+Collection.prototype.find = function(query, options) {
+  this.ops++;
+  return this;
+};
+Collection.prototype.insert = function(docs, options, callback) {
+  this.ops++;
+  callback(null, docs);
+  return this;
+};
+
+var cases = [
+  {
+    name: 'redis send_command, around + aroundCallback',
+    target: RedisClient.prototype,
+    make: function() {
+      return new RedisClient();
+    },
+    run: function(client) {
+      client.send_command('set', ['key', 'value'], noop);
+    },
+    patch: function(target) {
+      aspect.around(
+        target,
+        'send_command',
+        function(obj, methodName, args, probeData) {
+          probeData.start = 1;
+          aspect.aroundCallback(args, probeData, function(obj, args, probeData) {
+            probeData.called = true;
+          });
+        },
+        function(obj, methodName, args, probeData, ret) {
+          return ret;
+        }
+      );
+    },
+  },
+  {
+    name: 'mongo find, before without context',
+    target: Collection.prototype,
+    make: function() {
+      return new Collection();
+    },
+    run: function(collection) {
+      collection.find({ a: 1 }, {});
+    },
+    patch: function(target) {
+      aspect.before(target, 'find', function(obj, methodName, args) {
+        obj.lastQuery = args[0];
+      });
+    },
+  },
+  {
+    name: 'mongo insert, before + aroundCallback',
+    target: Collection.prototype,
+    make: function() {
+      return new Collection();
+    },
+    run: function(collection) {
+      collection.insert({ a: 1 }, {}, noop);
+    },
+    patch: function(target) {
+      aspect.before(target, 'insert', function(obj, methodName, args, probeData) {
+        aspect.aroundCallback(args, probeData, function(obj, args, probeData) {});
+      });
+    },
+  },
+];
+
+function time(instance, run) {
+  // Warm up so both runs are measured with optimized code
+  for (var i = 0; i < 100000; i++) run(instance);
+  var start = process.hrtime();
+  for (var j = 0; j < iterations; j++) run(instance);
+  var elapsed = process.hrtime(start);
+  return (elapsed[0] * 1e9 + elapsed[1]) / iterations;
+}
+
+cases.forEach(function(c) {
+  var instance = c.make();
+  var unpatched = time(instance, c.run);
+  c.patch(c.target);
+  var patched = time(instance, c.run);
+  console.log(
+    c.name +
+      ': ' +
+      unpatched.toFixed(1) +
+      'ns unpatched, ' +
+      patched.toFixed(1) +
+      'ns patched, ' +
+      (patched - unpatched).toFixed(1) +
+      'ns overhead'
+  );
+});
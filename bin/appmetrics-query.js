@@ -0,0 +1,75 @@
+#!/usr/bin/env node
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+'use strict';
+
+/*
+ * Lists or queries a columnar (.amc) appmetrics recording.
+ *
+ *   appmetrics-query <file>                          list the recorded series
+ *   appmetrics-query <file> <source|*> [from] [to]   print the recorded lines
+ *
+ * from and to are times in ms since the epoch or anything Date.parse accepts.
+ */
+
+var ColumnarReader = require('../lib/columnar-reader.js');
+
+function parseTime(value) {
+  if (value === undefined) return undefined;
+  var time = isNaN(value) ? Date.parse(value) : Number(value);
+  if (isNaN(time)) {
+    console.error('Invalid time: ' + value);
+    process.exit(1);
+  }
+  return time;
+}
+
+var args = process.argv.slice(2);
+if (args.length < 1) {
+  console.error('Usage: appmetrics-query <file> [<source|*> [from] [to]]');
+  process.exit(1);
+}
+
+var reader;
+try {
+  reader = new ColumnarReader(args[0]);
+} catch (err) {
+  console.error(err.message);
+  process.exit(1);
+}
+
+if (args.length === 1) {
+  if (!reader.complete) {
+    console.log('(recording was not closed, index rebuilt from the data)');
+  }
+  reader.list().forEach(function(series) {
+    console.log(
+      [
+        series.source,
+        series.name || '-',
+        series.columns + ' columns',
+        series.rows + ' rows',
+        series.from === null ? '' : new Date(series.from).toISOString() + ' - ' + new Date(series.to).toISOString(),
+      ].join('\t')
+    );
+  });
+} else {
+  var source = args[1] === '*' ? null : args[1];
+  reader.query(source, parseTime(args[2]), parseTime(args[3])).forEach(function(row) {
+    console.log(row.time + '\t' + row.source + '\t' + ColumnarReader.line(row));
+  });
+}
+reader.close();
@@ -110,6 +110,10 @@
         "<(INTERMEDIATE_DIR)/appmetrics.cpp",
         "<(srcdir)/headlessutils.cpp",
         "<(srcdir)/objecttracker.cpp",
+        "<(srcdir)/recorder.cpp",
+        "<(srcdir)/history.cpp",
+        "<(srcdir)/rollup.cpp",
+        "<(srcdir)/httpsummary.cpp",
       ],
       'variables': {
         'appmetricslevel%':'<(appmetricsversion)<(build_id)',
@@ -153,6 +157,14 @@
         "<(srcdir)/plugins/node/prof/nodeprofplugin.cpp",
       ],
     },
+    {
+      "target_name": "nodeallocplugin",
+      "win_delay_load_hook": "false",
+      "type": "shared_library",
+      "sources": [
+        "<(srcdir)/plugins/node/alloc/nodeallocplugin.cpp",
+      ],
+    },
     {
       "target_name": "nodeloopplugin",
       "win_delay_load_hook": "false",
@@ -180,6 +192,7 @@
         "nodeenvplugin",
         "nodegcplugin",
         "nodeprofplugin",
+        "nodeallocplugin",
         "nodeloopplugin",
         "nodeheapplugin",
       ],
@@ -189,6 +202,12 @@
             "nodezmemoryplugin",
           ],
         }],
+        ['OS=="linux"', {
+          "dependencies+": [
+            "nodelinuxmemoryplugin",
+            "nodethreadcpuplugin",
+          ],
+        }],
       ],
      "copies": [
        {
@@ -206,6 +225,7 @@
            "<(PRODUCT_DIR)/<(SHARED_LIB_PREFIX)nodeheapplugin<(SHARED_LIB_SUFFIX)",
            "<(PRODUCT_DIR)/<(SHARED_LIB_PREFIX)nodegcplugin<(SHARED_LIB_SUFFIX)",
            "<(PRODUCT_DIR)/<(SHARED_LIB_PREFIX)nodeprofplugin<(SHARED_LIB_SUFFIX)",
+           "<(PRODUCT_DIR)/<(SHARED_LIB_PREFIX)nodeallocplugin<(SHARED_LIB_SUFFIX)",
            "<(PRODUCT_DIR)/<(SHARED_LIB_PREFIX)nodeloopplugin<(SHARED_LIB_SUFFIX)",
            "<(agentcoredir)/plugins/<(SHARED_LIB_PREFIX)hcmqtt<(SHARED_LIB_SUFFIX)",
            "<(agentcoredir)/plugins/<(SHARED_LIB_PREFIX)cpuplugin<(SHARED_LIB_SUFFIX)",
@@ -228,6 +248,16 @@
                "<(PRODUCT_DIR)/<(SHARED_LIB_PREFIX)nodezmemoryplugin<(SHARED_LIB_SUFFIX)",
              ],
            }],
+           ['OS=="linux"', {
+             # /proc and cgroup aware replacement for the memory plugin
+             "files!": [
+               "<(agentcoredir)/plugins/<(SHARED_LIB_PREFIX)memoryplugin<(SHARED_LIB_SUFFIX)",
+             ],
+             "files+": [
+               "<(PRODUCT_DIR)/<(SHARED_LIB_PREFIX)nodelinuxmemoryplugin<(SHARED_LIB_SUFFIX)",
+               "<(PRODUCT_DIR)/<(SHARED_LIB_PREFIX)nodethreadcpuplugin<(SHARED_LIB_SUFFIX)",
+             ],
+           }],
          ],
        },
      ],
@@ -241,6 +271,27 @@
           "type": "shared_library",
           "sources": [
             "<(srcdir)/plugins/node/memory/nodezmemoryplugin.cpp",
+            "<(srcdir)/plugins/node/common/hostfacts.cpp",
+          ],
+        },
+      ],
+    }],
+    ['OS=="linux"', {
+      "targets+": [
+        {
+          "target_name": "nodelinuxmemoryplugin",
+          "type": "shared_library",
+          "sources": [
+            "<(srcdir)/plugins/node/memory/nodelinuxmemoryplugin.cpp",
+            "<(srcdir)/plugins/node/common/hostfacts.cpp",
+          ],
+        },
+        {
+          "target_name": "nodethreadcpuplugin",
+          "type": "shared_library",
+          "sources": [
+            "<(srcdir)/plugins/node/cpu/nodethreadcpuplugin.cpp",
+            "<(srcdir)/plugins/node/common/hostfacts.cpp",
           ],
         },
       ],
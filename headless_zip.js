@@ -17,25 +17,16 @@
 
 var fs = require('fs');
 var path = require('path');
-var JSZip = require('jszip');
+var agent = require('./appmetrics');
 
 var dirToWriteTo;
 var filesToKeep = 10;
 var filesWritten = [];
-
-function deleteDir(directory) {
-  // Delete temporary directory
-  if (fs.existsSync(directory)) {
-    fs.readdirSync(directory).forEach(function(file, index) {
-      var fileName = path.join(directory, file);
-      fs.unlinkSync(fileName);
-    });
-    fs.rmdirSync(directory);
-  }
-}
+// Temporary directories being zipped on the threadpool, and their archives
+var zipping = {};
 
 function deleteFile(filename) {
-  fs.unlink(filename);
+  fs.unlink(filename, function() {});
 }
 
 module.exports.setHeadlessOutputDir = function setHeadlessOutputDir(dir) {
@@ -69,31 +60,62 @@ function pad(numberString) {
   return numberString;
 }
 
-module.exports.headlessZip = function headlessZip(dirToZip) {
+function outputFile(extension) {
   var outputFileName;
   if (dirToWriteTo) {
-    outputFileName = path.join(dirToWriteTo, 'nodeappmetrics' + timestamp() + '.hcd');
+    outputFileName = path.join(dirToWriteTo, 'nodeappmetrics' + timestamp() + (extension || '.hcd'));
   } else {
-    outputFileName = 'nodeappmetrics' + timestamp() + '.hcd';
+    outputFileName = 'nodeappmetrics' + timestamp() + (extension || '.hcd');
   }
+  return outputFileName;
+}
+
+module.exports.outputFile = outputFile;
 
+function recordFile(outputFileName) {
   filesWritten.push(outputFileName);
   if (filesWritten.length > filesToKeep) {
     var earliest = filesWritten.shift();
     deleteFile(earliest);
   }
+}
 
-  if (fs.existsSync(dirToZip)) {
-    var zip = new JSZip();
-    var files = fs.readdirSync(dirToZip);
-    for (var i = 0, len = files.length; i < len; i++) {
-      zip.file(files[i], fs.readFileSync(path.join(dirToZip, files[i])), {
-        compression: 'DEFLATE',
-      });
+// The archive is streamed to disk on the libuv threadpool, which also removes
+// the temporary directory once it is complete
+module.exports.headlessZip = function headlessZip(dirToZip) {
+  var outputFileName = outputFile();
+  zipping[dirToZip] = outputFileName;
+  agent.zipDirectory(dirToZip, outputFileName, function(err) {
+    delete zipping[dirToZip];
+    if (!err) {
+      recordFile(outputFileName);
+    }
+  });
+};
+
+/*
+ * Records to a new .amc file every runDuration minutes, keeping filesToKeep
+ * of them as for .hcd files, and stops after numberOfRuns files. A duration
+ * or number of runs of 0 means no limit.
+ */
+module.exports.startRecording = function startRecording(runDuration, numberOfRuns) {
+  var runs = 0;
+  function nextRun() {
+    if (runs > 0) {
+      // Stopped by appmetrics.stop()
+      if (!agent.isRecording()) return;
+      agent.stopRecording();
+    }
+    if (numberOfRuns > 0 && runs >= numberOfRuns) return;
+    var outputFileName = outputFile('.amc');
+    agent.startRecording(outputFileName);
+    recordFile(outputFileName);
+    runs++;
+    if (runDuration > 0) {
+      setTimeout(nextRun, runDuration * 60 * 1000).unref();
     }
-    fs.writeFileSync(outputFileName, zip.generate({ type: 'nodebuffer', compression: 'DEFLATE' }));
-    deleteDir(dirToZip);
   }
+  nextRun();
 };
 
 module.exports.tryZipOnExit = function tryZipOnExit() {
@@ -103,8 +125,18 @@ module.exports.tryZipOnExit = function tryZipOnExit() {
     // Search for temporary output directory using pattern matching
     for (var i = 0, len = files.length; i < len; i++) {
       if (/tmp_(\w+)/.test(files[i].toString())) {
+        // The threadpool won't run again once the process is exiting. If the
+        // directory is already being zipped there, zipDirectorySync waits for
+        // that to finish, then fails as the directory has gone.
         var dirToZip = path.join(outputDir, files[i]);
-        this.headlessZip(dirToZip);
+        var outputFileName = zipping[dirToZip] || outputFile();
+        try {
+          agent.zipDirectorySync(dirToZip, outputFileName);
+        } catch (err) {
+          // Leave the temporary directory for the next run to pick up
+          if (!(dirToZip in zipping) || fs.existsSync(dirToZip)) return;
+        }
+        recordFile(outputFileName);
         return;
       }
     }
@@ -33,3 +33,11 @@ addon.configure(flags);
 exports.writeSnapshot = function() {
   return addon.writeSnapshot.apply(null, arguments);
 };
+
+// Whether SIGUSR2 should write a snapshot, as configured by NODE_HEAPDUMP_OPTIONS.
+exports.signalEnabled = (flags & kSignalFlag) !== 0;
+
+// Turn the native SIGUSR2 handler on or off, so the signal can be handled in JS.
+exports.setNativeSignalHandler = function(enabled) {
+  addon.configure(enabled ? flags : flags & ~kSignalFlag);
+};
@@ -40,6 +40,7 @@ if (global.Appmetrics) {
   var module_dir = path.dirname(module.filename);
   var aspect = require('./lib/aspect.js');
   var request = require('./lib/request.js');
+  var httpSummary = require('./lib/http-summary.js');
   var fs = require('fs');
   var agent = require('./appmetrics');
   const os = require('os');
@@ -47,6 +48,8 @@ if (global.Appmetrics) {
   if (notOnZOS) {
     var headlessZip = require('./headless_zip.js');
     var heapdump = require('./heapdump.js');
+    var SnapshotStore = require('./lib/snapshot-store.js');
+    var snapshotStore = null;
   }
 
   // Set the plugin search path
@@ -63,6 +66,7 @@ if (global.Appmetrics) {
     applicationID: 'com.ibm.diagnostics.healthcenter.mqtt.application.id',
     mqtt: 'com.ibm.diagnostics.healthcenter.mqtt',
     profiling: 'com.ibm.diagnostics.healthcenter.data.profiling',
+    allocation: 'com.ibm.diagnostics.healthcenter.data.allocation',
   };
 
   if (notOnZOS) {
@@ -75,27 +79,48 @@ if (global.Appmetrics) {
       'appmetrics.file.run.number.of.runs': 'com.ibm.diagnostics.healthcenter.headless.run.number.of.runs',
       'appmetrics.file.files.to.keep': 'com.ibm.diagnostics.healthcenter.headless.files.to.keep',
       'appmetrics.file.output.directory': 'com.ibm.diagnostics.healthcenter.headless.output.directory',
+      'appmetrics.file.format': 'com.ibm.diagnostics.healthcenter.headless.format',
     };
   }
   /*
- * Load module probes into probes array by searching the probes directory.
+ * Probes are loaded from the probes directory when the module they instrument
+ * is first required, or when they are first enabled, disabled or configured,
+ * rather than all at startup, using the table in lib/probe-files.js.
  * We handle the 'trace' probe as a special case because we don't want to put
- * the probe hooks in by default due to the performance cost.
+ * the probe hooks in by default due to the performance cost. It is loaded by
+ * enable('trace') and then attached to every module required.
  */
+  var probeFiles = require('./lib/probe-files.js');
+  var NO_PROBES = [];
+
+  // Every probe loaded so far, and those loaded for each module name
   var probes = [];
-  var traceProbe;
-
-  var dirPath = path.join(__dirname, 'probes');
-  var files = fs.readdirSync(dirPath);
-  files.forEach(function(fileName) {
-    var file = path.join(dirPath, fileName);
-    var probeModule = new (require(file))();
-    if (probeModule.name === 'trace') {
-      traceProbe = probeModule;
-    } else {
-      probes.push(probeModule);
-    }
-  });
+  var namedProbes = new Map();
+  var traceProbe = null;
+
+  // State to give probes as they are loaded
+  var probesStarted = false;
+  var requestsEnabled = false;
+  var requestsExcluded = new Set();
+
+  function loadProbe(fileName) {
+    var probe = new (require(path.join(__dirname, 'probes', fileName)))();
+    if (requestsEnabled && !requestsExcluded.has(probe.name)) probe.enableRequests();
+    if (probesStarted) probe.start();
+    probes.push(probe);
+    return probe;
+  }
+
+  function getProbes(name) {
+    if (name === 'trace') return traceProbe === null ? NO_PROBES : [traceProbe];
+    var named = namedProbes.get(name);
+    if (named !== undefined) return named;
+    var files = probeFiles.get(name);
+    if (files === undefined) return NO_PROBES;
+    named = files.map(loadProbe);
+    namedProbes.set(name, named);
+    return named;
+  }
 
   var latencyData = {
     count: 0,
@@ -138,6 +163,10 @@ if (global.Appmetrics) {
   latencyCheckLoop.unref();
   latencyReportLoop.unref();
 
+  // Native 1s/10s/1m summaries of gc, loop and http data, see enable('rollups')
+  var rollups = false;
+  var rawEvents = true;
+
 
   /*
  * Patch the module require function to run the probe attach function
@@ -145,19 +174,26 @@ if (global.Appmetrics) {
  */
   var data = {};
 
+  function attachProbe(probe, name, target) {
+    return probe.attach(name, target, module.exports);
+  }
+
   /* eslint no-proto:0 */
   aspect.after(module.__proto__, 'require', data, function(obj, methodName, args, context, ret) {
     if (ret == null || ret.__ddProbeAttached__) {
       return ret;
     } else {
-      for (var i = 0; i < probes.length; i++) {
-        if (probes[i].name === args[0]) {
-          ret = probes[i].attach(args[0], ret, module.exports);
-        }
-        if (probes[i].name === 'trace') {
-          ret = probes[i].attach(args[0], ret);
+      var name = args[0];
+      if (probeFiles.has(name)) {
+        var named = getProbes(name);
+        for (var i = 0; i < named.length; i++) {
+          // Record the probe's patches so disabling it can take them out
+          ret = aspect.attaching(named[i], attachProbe.bind(null, named[i], name, ret));
         }
       }
+      if (traceProbe !== null) {
+        ret = traceProbe.attach(name, ret);
+      }
       return ret;
     }
   });
@@ -184,14 +220,28 @@ if (global.Appmetrics) {
       case 'profiling':
         agent.sendControlCommand('profiling_node', 'on,profiling_node_subsystem');
         break;
+      case 'allocation':
+        agent.sendControlCommand('allocation_node', 'on,allocation_node_subsystem');
+        break;
+      case 'rollups':
+        rollups = true;
+        agent.setRollups(true, rawEvents);
+        break;
+      case 'http-summary':
+        httpSummary.enable();
+        break;
       case 'requests':
+        // For probes loaded later as well as those already loaded, until
+        // excludeModules is set again
+        requestsEnabled = true;
+        requestsExcluded.clear();
         probes.forEach(function(probe) {
           probe.enableRequests();
         });
         break;
       case 'trace':
-        if (probes.indexOf(traceProbe) === -1) {
-          probes.push(traceProbe);
+        if (traceProbe === null) {
+          traceProbe = loadProbe('trace-probe.js');
         }
         traceProbe.enable();
         break;
@@ -202,10 +252,8 @@ if (global.Appmetrics) {
         latencyReportLoop = setInterval(latencyReport, latencyReportInterval);
         break;
       default:
-        probes.forEach(function(probe) {
-          if (probe.name == data) {
-            probe.enable();
-          }
+        getProbes(data).forEach(function(probe) {
+          probe.enable();
         });
     }
     if (config) module.exports.setConfig(data, config);
@@ -222,7 +270,18 @@ if (global.Appmetrics) {
       case 'profiling':
         agent.sendControlCommand('profiling_node', 'off,profiling_node_subsystem');
         break;
+      case 'allocation':
+        agent.sendControlCommand('allocation_node', 'off,allocation_node_subsystem');
+        break;
+      case 'rollups':
+        rollups = false;
+        agent.setRollups(false, true);
+        break;
+      case 'http-summary':
+        httpSummary.disable();
+        break;
       case 'requests':
+        requestsEnabled = false;
         probes.forEach(function(probe) {
           probe.disableRequests();
         });
@@ -234,10 +293,8 @@ if (global.Appmetrics) {
         clearInterval(latencyReportLoop);
         break;
       default:
-        probes.forEach(function(probe) {
-          if (probe.name == data) {
-            probe.disable();
-          }
+        getProbes(data).forEach(function(probe) {
+          probe.disable();
         });
     }
   };
@@ -254,6 +311,7 @@ if (global.Appmetrics) {
         /* check for exclude modules and disable those to be excluded */
         if (typeof config.excludeModules !== 'undefined') {
           config.excludeModules.forEach(function(module) {
+            requestsExcluded.add(module);
             probes.forEach(function(probe) {
               if (probe.name === module) {
                 probe.disableRequests();
@@ -262,32 +320,146 @@ if (global.Appmetrics) {
           });
         }
         break;
+      case 'heapdump':
+        if (notOnZOS) configureSnapshotStore(config);
+        break;
+      case 'rollups':
+        if (typeof config.raw !== 'undefined') rawEvents = Boolean(config.raw);
+        if (rollups) agent.setRollups(true, rawEvents);
+        break;
+      case 'http-summary':
+        httpSummary.setConfig(config);
+        break;
       case 'advancedProfiling':
         if (typeof config.threshold !== 'undefined')
           agent.sendControlCommand('profiling_node', config.threshold + ',profiling_node_threshold');
         break;
+      case 'allocation':
+        if (typeof config.sampleInterval !== 'undefined')
+          agent.sendControlCommand('allocation_node', config.sampleInterval + ',allocation_node_sample_interval');
+        if (typeof config.interval !== 'undefined')
+          agent.sendControlCommand('allocation_node', config.interval + ',allocation_node_interval');
+        break;
       default:
-        probes.forEach(function(probe) {
-          if (probe.name == data) {
-            probe.setConfig(config);
-          }
+        getProbes(data).forEach(function(probe) {
+          probe.setConfig(config);
         });
     }
   };
 
+  var nativeTopics = ['http', 'mqlight', 'mongo', 'mysql'];
+
   // Export emit() API for JS data providers
   module.exports.emit = function(topic, data) {
-    if (typeof this.api !== 'undefined') {
+    // When only rollups are wanted, http events are summarized natively
+    var raw = rawEvents || !rollups || topic != 'http';
+    if (raw && typeof this.api !== 'undefined') {
     // We have a listener, so fast path the notification to them
       this.api.raiseLocalEvent(topic, data);
     }
     // Publish data that can be visualised in Health Center
-    if (topic == 'http' || topic == 'mqlight' || topic == 'mongo' || topic == 'mysql') {
-      data = JSON.stringify(data);
-      agent.nativeEmit(topic, String(data));
+    if (nativeTopics.indexOf(topic) !== -1) {
+      agent.nativeEmit(topic, JSON.stringify(data));
     }
   };
 
+  // As emit() for each of a burst of events of one type, passed to the agent together
+  module.exports.emitMany = function(topic, items) {
+    var raw = rawEvents || !rollups || topic != 'http';
+    if (raw && typeof this.api !== 'undefined') {
+      for (var i = 0; i < items.length; i++) {
+        this.api.raiseLocalEvent(topic, items[i]);
+      }
+    }
+    if (nativeTopics.indexOf(topic) !== -1 && items.length > 0) {
+      agent.nativeEmitMany(
+        topic,
+        items.map(function(item) {
+          return JSON.stringify(item);
+        })
+      );
+    }
+  };
+
+  function processExists(pid) {
+    try {
+      process.kill(pid, 0);
+      return true;
+    } catch (err) {
+      return err.code === 'EPERM';
+    }
+  }
+
+  // Removes the per-pid ring files of processes of the same name that have exited
+  function pruneHistory(dir, name) {
+    var escaped = name.replace(/[.*+?^${}()|[\]\\]/g, '\\$&');
+    var pidRing = new RegExp('^' + escaped + '-(\\d+)-(' + historyTypes.join('|') + ')\\.ring$');
+    var files;
+    try {
+      files = fs.readdirSync(dir);
+    } catch (err) {
+      return;
+    }
+    files.forEach(function(file) {
+      var match = pidRing.exec(file);
+      if (match === null || processExists(parseInt(match[1], 10))) return;
+      try {
+        fs.unlinkSync(path.join(dir, file));
+      } catch (err) {
+        // Removed by another process starting
+      }
+    });
+  }
+
+  // Keep recent gc, loop, memory, cpu and http data in ring files that outlive the process
+  function startHistory() {
+    if (agent.getOption('com.ibm.diagnostics.healthcenter.history') != 'on') return;
+    var dir =
+      agent.getOption('com.ibm.diagnostics.healthcenter.history.directory') ||
+      path.join(os.tmpdir(), 'appmetrics-history');
+    var size = parseInt(agent.getOption('com.ibm.diagnostics.healthcenter.history.size'), 10) || 1024 * 1024;
+    var name = path.basename(main_filename, path.extname(main_filename)).replace(/[^\w.-]/g, '_') || 'node';
+    try {
+      fs.mkdirSync(dir, 0o700);
+    } catch (err) {
+      if (err.code !== 'EEXIST') return;
+    }
+    // The rings hold request data, so only use a directory that is ours and
+    // not readable by anyone else, such as the shared default in /tmp
+    try {
+      var stats = fs.lstatSync(dir);
+      if (!stats.isDirectory()) return;
+      if (process.getuid) {
+        if (stats.uid !== process.getuid()) return;
+        if (stats.mode & 0o077) fs.chmodSync(dir, 0o700);
+      }
+    } catch (err) {
+      return;
+    }
+    pruneHistory(dir, name);
+    agent.startHistory(dir, name, size);
+  }
+
+  var historyTypes = ['gc', 'loop', 'memory', 'cpu', 'http'];
+
+  // Returns the events of type raised between from and to, oldest first
+  module.exports.history = function(type, from, to) {
+    if (historyTypes.indexOf(type) === -1) {
+      throw new Error('History is only kept for ' + historyTypes.join(', '));
+    }
+    var records = agent.readHistory(type, isFinite(from) ? from : undefined, isFinite(to) ? to : undefined);
+    if (!records) return [];
+    return this.monitor()
+      .decodeHistory(records)
+      .filter(function(event) {
+        return event.topic === type;
+      })
+      .map(function(event) {
+        if (event.data.time === undefined) event.data.time = event.time;
+        return event.data;
+      });
+  };
+
   // Export monitor() API for consuming data in-process
   module.exports.monitor = function() {
     if (typeof this.api == 'undefined') {
@@ -327,13 +499,92 @@ if (global.Appmetrics) {
     return jsonProfilingMode;
   };
 
+  // No longer called by the native memory plugins, kept for compatibility
   module.exports.getTotalPhysicalMemorySize = function() {
     return os.totalmem();
   };
 
+  module.exports.histogramSession = function(options) {
+    return new agent.HistogramSession(options);
+  };
+
   if (notOnZOS) {
-    module.exports.writeSnapshot = function(args) {
-      return heapdump.writeSnapshot(args);
+    /*
+     * Writes a snapshot and emits a 'heapdump' event describing its cost:
+     * how long it took and, when written by a forked child, the child's peak
+     * RSS, page faults and how it exited.
+     */
+    var writeSnapshotWithMetrics = function(filename, callback) {
+      if (typeof filename === 'function') {
+        callback = filename;
+        filename = undefined;
+      }
+      return heapdump.writeSnapshot(filename, function(err, filename, stats) {
+        var data = { time: Date.now(), filename: filename };
+        for (var key in stats) {
+          data[key] = stats[key];
+        }
+        if (err) data.error = err.message;
+        module.exports.emit('heapdump', data);
+        if (typeof callback === 'function') callback(err, filename, stats);
+      });
+    };
+
+    var onSnapshotSignal = function() {
+      snapshotStore.write('signal');
+    };
+
+    var onSnapshotGC = function(gc) {
+      snapshotStore.onGC(gc);
+    };
+
+    /*
+     * Once a snapshot directory is configured, snapshots requested without a
+     * filename, via SIGUSR2 or by the heap threshold go into the store.
+     * Passing a config without a directory turns the store off again.
+     */
+    // The gc listener is only there if monitoring was started, so don't start it to remove it
+    var removeSnapshotGC = function() {
+      if (typeof module.exports.api !== 'undefined') {
+        module.exports.api.removeListener('gc', onSnapshotGC);
+      }
+    };
+
+    var configureSnapshotStore = function(config) {
+      if (!config || !config.directory) {
+        if (snapshotStore) {
+          process.removeListener('SIGUSR2', onSnapshotSignal);
+          removeSnapshotGC();
+          if (heapdump.signalEnabled) heapdump.setNativeSignalHandler(true);
+          snapshotStore = null;
+        }
+        return;
+      }
+      if (snapshotStore) {
+        snapshotStore.configure(config);
+      } else {
+        snapshotStore = new SnapshotStore(writeSnapshotWithMetrics, config);
+        if (heapdump.signalEnabled) {
+          heapdump.setNativeSignalHandler(false);
+          process.on('SIGUSR2', onSnapshotSignal);
+        }
+      }
+      removeSnapshotGC();
+      // Monitoring is only started when gc events are needed for the threshold
+      if (snapshotStore.heapUsedThreshold > 0) {
+        module.exports.monitor().on('gc', onSnapshotGC);
+      }
+    };
+
+    module.exports.writeSnapshot = function(filename, callback) {
+      if (snapshotStore && typeof filename !== 'string') {
+        return snapshotStore.write('manual', typeof filename === 'function' ? filename : callback);
+      }
+      return writeSnapshotWithMetrics(filename, callback);
+    };
+
+    module.exports.listSnapshots = function() {
+      return snapshotStore ? snapshotStore.list() : [];
     };
   }
 
@@ -354,9 +605,27 @@ if (global.Appmetrics) {
       if (headlessFilesToKeep && !isNaN(headlessFilesToKeep) && headlessFilesToKeep > 0) {
         headlessZip.setFilesToKeep(headlessFilesToKeep);
       }
+      // The columnar format is written by the addon rather than the agent's
+      // own headless output, so turn that off
+      var columnar =
+        agent.getOption('com.ibm.diagnostics.healthcenter.headless') == 'on' &&
+        agent.getOption('com.ibm.diagnostics.healthcenter.headless.format') == 'columnar';
+      if (columnar) {
+        agent.setOption('com.ibm.diagnostics.healthcenter.headless', 'off');
+      }
     }
     var am = this;
     agent.start();
+    startHistory();
+    if (columnar) {
+      if (headlessOutputDir && !fs.existsSync(headlessOutputDir)) {
+        fs.mkdirSync(headlessOutputDir);
+      }
+      headlessZip.startRecording(
+        parseFloat(agent.getOption('com.ibm.diagnostics.healthcenter.headless.run.duration')) || 0,
+        parseInt(agent.getOption('com.ibm.diagnostics.healthcenter.headless.run.number.of.runs'), 10) || 0
+      );
+    }
     process.on('exit', function() {
     // take the event loop latency methods off the loop
       if (latencyRunning === true) {
@@ -372,7 +641,8 @@ if (global.Appmetrics) {
       }
     });
 
-    // Start the probes
+    // Start the probes, and any loaded later
+    probesStarted = true;
     probes.forEach(function(probe) {
       probe.start();
     });
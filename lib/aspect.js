@@ -14,7 +14,105 @@
  * limitations under the License.
  *******************************************************************************/
 'use strict';
-var appmetrics = require('../');
+// Loaded when first needed, so the wrappers can be used without the agent
+var appmetrics = null;
+
+/*
+ * Patches made while a probe is attaching are recorded against it, so they
+ * can be taken out when it is disabled and put back when it is enabled. If
+ * something else has wrapped a patched method since, the patch is left in
+ * place but passes calls straight through while it is inactive.
+ */
+var attachingProbe = null;
+
+function Patch(target, methodName, original, wrapper) {
+  this.target = target;
+  this.methodName = methodName;
+  this.original = original;
+  this.wrapper = wrapper;
+  this.own = target !== null && Object.prototype.hasOwnProperty.call(target, methodName);
+  this.active = true;
+}
+
+// Used for patches made outside of a probe's attach, which are always active
+var ALWAYS_ACTIVE = { active: true };
+
+function newPatch(target, methodName, original) {
+  if (attachingProbe === null) return ALWAYS_ACTIVE;
+  return new Patch(target, methodName, original, null);
+}
+
+// Installs the wrapper for patch and hands it to the attaching probe
+function install(patch, target, methodName, wrapper) {
+  if (target !== null) target[methodName] = wrapper;
+  if (patch !== ALWAYS_ACTIVE) {
+    patch.wrapper = wrapper;
+    attachingProbe.addPatch(patch);
+  }
+}
+
+exports.attaching = function(probe, attach) {
+  var previous = attachingProbe;
+  attachingProbe = probe;
+  try {
+    return attach();
+  } finally {
+    attachingProbe = previous;
+  }
+};
+
+exports.unwrap = function(patches) {
+  for (var i = patches.length - 1; i >= 0; i--) {
+    var patch = patches[i];
+    patch.active = false;
+    if (patch.target !== null && patch.target[patch.methodName] === patch.wrapper) {
+      if (patch.own) {
+        patch.target[patch.methodName] = patch.original;
+      } else {
+        delete patch.target[patch.methodName];
+      }
+    }
+  }
+};
+
+exports.rewrap = function(patches) {
+  for (var i = 0; i < patches.length; i++) {
+    var patch = patches[i];
+    patch.active = true;
+    if (patch.target !== null && patch.target[patch.methodName] === patch.original) {
+      patch.target[patch.methodName] = patch.wrapper;
+    }
+  }
+};
+
+/*
+ * The wrappers take their arguments as rest parameters, so hooks are given a
+ * real array rather than forcing V8 to materialize an arguments object, and
+ * call through with invoke() which avoids apply() for the common arities.
+ * A context object is only allocated for hooks that declare a parameter for
+ * it.
+ */
+function invoke(fn, self, args) {
+  switch (args.length) {
+    case 0:
+      return fn.call(self);
+    case 1:
+      return fn.call(self, args[0]);
+    case 2:
+      return fn.call(self, args[0], args[1]);
+    case 3:
+      return fn.call(self, args[0], args[1], args[2]);
+    case 4:
+      return fn.call(self, args[0], args[1], args[2], args[3]);
+    default:
+      return fn.apply(self, args);
+  }
+}
+
+// Whether hook declares a parameter at position, eg. for its context
+function takes(hook, position) {
+  return typeof hook === 'function' && hook.length > position;
+}
 
 exports.aroundCallback = function(args, context, hookBefore, hookAfter) {
   var position = this.findCallbackArg(args);
@@ -22,48 +120,46 @@ exports.aroundCallback = function(args, context, hookBefore, hookAfter) {
 
   var orig = args[position];
 
-  args[position] = function() {
+  args[position] = function(...cbArgs) {
     if (hookBefore) {
-      hookBefore(this, arguments, context);
+      hookBefore(this, cbArgs, context);
     }
 
-    var ret = orig.apply(this, arguments);
+    var ret = invoke(orig, this, cbArgs);
 
     if (hookAfter) {
-      hookAfter(this, arguments, context, ret);
+      hookAfter(this, cbArgs, context, ret);
     }
     return ret;
   };
 };
 
 exports.findCallbackArg = function(args) {
-  var position;
   for (var i = 0; i < args.length; i++) {
-    if (typeof args[i] === 'function') {
-      position = i;
-      break;
-    }
+    if (typeof args[i] === 'function') return i;
   }
-  return position;
+  return undefined;
 };
 
 exports.before = function(target, meths, hookBefore) {
   if (!Array.isArray(meths)) {
     meths = [meths];
   }
+  var needsContext = takes(hookBefore, 3);
 
   meths.forEach(function(methodName) {
     var existing = target[methodName];
     if (!existing) return;
 
-    var newFunc = function() {
-      var context = {};
-      hookBefore(this, methodName, arguments, context);
-      return existing.apply(this, arguments);
+    var patch = newPatch(target, methodName, existing);
+    var newFunc = function(...args) {
+      if (!patch.active) return invoke(existing, this, args);
+      hookBefore(this, methodName, args, needsContext ? {} : undefined);
+      return invoke(existing, this, args);
     };
     newFunc.prototype = existing.prototype;
 
-    target[methodName] = newFunc;
+    install(patch, target, methodName, newFunc);
   });
 };
 
@@ -71,20 +167,23 @@ exports.around = function(target, meths, hookBefore, hookAfter) {
   if (!Array.isArray(meths)) {
     meths = [meths];
   }
+  var needsContext = takes(hookBefore, 3) || takes(hookAfter, 3);
 
   meths.forEach(function(methodName) {
     var existing = target[methodName];
     if (!existing) return;
 
-    var newFunc = function() {
-      var context = {};
-      hookBefore(this, methodName, arguments, context);
-      var ret = existing.apply(this, arguments);
-      return hookAfter(this, methodName, arguments, context, ret);
+    var patch = newPatch(target, methodName, existing);
+    var newFunc = function(...args) {
+      if (!patch.active) return invoke(existing, this, args);
+      var context = needsContext ? {} : undefined;
+      hookBefore(this, methodName, args, context);
+      var ret = invoke(existing, this, args);
+      return hookAfter(this, methodName, args, context, ret);
     };
     newFunc.prototype = existing.prototype;
 
-    target[methodName] = newFunc;
+    install(patch, target, methodName, newFunc);
   });
 };
 
@@ -97,21 +196,26 @@ exports.after = function(target, meths, context, hookAfter) {
     var existing = target[methodName];
     if (!existing) return;
 
-    var newFunc = function() {
-      var ret = existing.apply(this, arguments);
-      return hookAfter(this, methodName, arguments, context, ret);
+    var patch = newPatch(target, methodName, existing);
+    var newFunc = function(...args) {
+      var ret = invoke(existing, this, args);
+      if (!patch.active) return ret;
+      return hookAfter(this, methodName, args, context, ret);
     };
     newFunc.prototype = existing.prototype;
 
-    target[methodName] = newFunc;
+    install(patch, target, methodName, newFunc);
   });
 };
 
 exports.afterConstructor = function(target, context, hookAfter) {
   if (typeof target === 'function') {
-    var newFunc = function() {
-      var ret = target.apply(null, arguments);
-      return hookAfter(this, '()', arguments, context, ret);
+    // The wrapper replaces the module's export so can't be taken out again
+    var patch = newPatch(null, null, target);
+    var newFunc = function(...args) {
+      var ret = invoke(target, null, args);
+      if (!patch.active) return ret;
+      return hookAfter(this, '()', args, context, ret);
     };
     for (var property in target) {
       if (target.hasOwnProperty(property)) {
@@ -120,6 +224,7 @@ exports.afterConstructor = function(target, context, hookAfter) {
     }
     newFunc.prototype = target.prototype;
     newFunc.exports = target.exports;
+    install(patch, null, null, newFunc);
     return newFunc;
   } else {
     return target;
@@ -128,5 +233,6 @@ exports.afterConstructor = function(target, context, hookAfter) {
 
 exports.strongTraceTransactionLink = function(probeName, methodName, callback) {
   var linkName = probeName + methodName;
+  if (appmetrics === null) appmetrics = require('../');
   appmetrics.transactionLink(linkName, callback);
 };
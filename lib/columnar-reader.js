@@ -0,0 +1,378 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+'use strict';
+
+/*
+ * Reader for the columnar .amc recordings written by src/recorder.cpp.
+ *
+ * Only the index is read when the file is opened; a query inflates just the
+ * chunks whose time range overlaps the one asked for. A file that was not
+ * closed cleanly has no index, in which case the chunk headers are scanned
+ * instead.
+ */
+
+var fs = require('fs');
+var zlib = require('zlib');
+
+var MAGIC = 'AMCR';
+var INDEX_MAGIC = 'AMCI';
+var HEADER_SIZE = 5;
+var TRAILER_SIZE = 12;
+var MAX_RECORD_HEADER = 128;
+
+var COLUMN_INT = 0;
+var COLUMN_DOUBLE = 1;
+var COLUMN_STRING = 2;
+
+function Cursor(buffer, position) {
+  this.buffer = buffer;
+  this.position = position || 0;
+}
+
+Cursor.prototype.byte = function() {
+  if (this.position >= this.buffer.length) {
+    throw new RangeError('Unexpected end of data');
+  }
+  return this.buffer[this.position++];
+};
+
+// Varints up to 2^53 are exact
+Cursor.prototype.varint = function() {
+  var result = 0;
+  var scale = 1;
+  var b;
+  do {
+    b = this.byte();
+    result += (b & 0x7f) * scale;
+    scale *= 128;
+  } while (b & 0x80);
+  return result;
+};
+
+Cursor.prototype.signed = function() {
+  var value = this.varint();
+  return value % 2 === 0 ? value / 2 : -(value + 1) / 2;
+};
+
+Cursor.prototype.string = function() {
+  var length = this.varint();
+  var end = this.position + length;
+  if (end > this.buffer.length) {
+    throw new RangeError('Unexpected end of data');
+  }
+  var value = this.buffer.toString('utf8', this.position, end);
+  this.position = end;
+  return value;
+};
+
+Cursor.prototype.bytes = function() {
+  var length = this.varint();
+  var value = this.buffer.slice(this.position, this.position + length);
+  this.position += length;
+  return value;
+};
+
+// Reads up to 64 bits as a pair of 32 bit halves
+function BitReader(buffer) {
+  this.buffer = buffer;
+  this.bit = 0;
+}
+
+BitReader.prototype.read = function(count, result) {
+  var hi = 0;
+  var lo = 0;
+  for (var i = 0; i < count; i++) {
+    var byte = this.buffer[this.bit >> 3];
+    var bit = (byte >> (7 - (this.bit & 7))) & 1;
+    this.bit++;
+    hi = ((hi << 1) | (lo >>> 31)) >>> 0;
+    lo = ((lo << 1) | bit) >>> 0;
+  }
+  result.hi = hi;
+  result.lo = lo;
+  return result;
+};
+
+function shiftLeft(value, count) {
+  for (var i = 0; i < count; i++) {
+    value.hi = ((value.hi << 1) | (value.lo >>> 31)) >>> 0;
+    value.lo = (value.lo << 1) >>> 0;
+  }
+}
+
+function readSeries(cursor) {
+  return {
+    id: cursor.varint(),
+    source: cursor.string(),
+    name: cursor.string(),
+    columns: cursor.varint(),
+  };
+}
+
+function decodeDoubles(cursor, rows) {
+  var bits = new BitReader(cursor.bytes());
+  var view = new DataView(new ArrayBuffer(8));
+  var values = new Array(rows);
+  var previous = { hi: 0, lo: 0 };
+  var xored = { hi: 0, lo: 0 };
+  var flag = { hi: 0, lo: 0 };
+  var leading = 0;
+  var trailing = 0;
+  for (var i = 0; i < rows; i++) {
+    if (i === 0) {
+      bits.read(64, previous);
+    } else if (bits.read(1, flag).lo === 1) {
+      if (bits.read(1, flag).lo === 1) {
+        leading = bits.read(5, flag).lo;
+        var significant = bits.read(6, flag).lo + 1;
+        trailing = 64 - leading - significant;
+      }
+      bits.read(64 - leading - trailing, xored);
+      shiftLeft(xored, trailing);
+      previous.hi = (previous.hi ^ xored.hi) >>> 0;
+      previous.lo = (previous.lo ^ xored.lo) >>> 0;
+    }
+    view.setUint32(0, previous.hi);
+    view.setUint32(4, previous.lo);
+    values[i] = view.getFloat64(0);
+  }
+  return values;
+}
+
+function decodeColumn(cursor, rows) {
+  var type = cursor.byte();
+  var values = new Array(rows);
+  var i;
+  if (type === COLUMN_INT) {
+    var previous = 0;
+    for (i = 0; i < rows; i++) {
+      previous += cursor.signed();
+      values[i] = previous;
+    }
+  } else if (type === COLUMN_DOUBLE) {
+    values = decodeDoubles(cursor, rows);
+  } else if (type === COLUMN_STRING) {
+    var dictionary = new Array(cursor.varint());
+    for (i = 0; i < dictionary.length; i++) {
+      dictionary[i] = cursor.string();
+    }
+    for (i = 0; i < rows; i++) {
+      values[i] = dictionary[cursor.varint()];
+    }
+  } else {
+    throw new Error('Unknown column type ' + type);
+  }
+  return values;
+}
+
+function ColumnarReader(filename) {
+  this.filename = filename;
+  this.fd = fs.openSync(filename, 'r');
+  this.series = [];
+  this.chunks = [];
+  this.complete = false;
+  try {
+    var size = fs.fstatSync(this.fd).size;
+    var header = this.read(0, HEADER_SIZE);
+    if (header.length < HEADER_SIZE || header.toString('ascii', 0, 4) !== MAGIC) {
+      throw new Error(filename + ' is not an appmetrics recording');
+    }
+    if (!this.readIndex(size)) {
+      this.scan(size);
+    }
+  } catch (err) {
+    this.close();
+    throw err;
+  }
+}
+
+ColumnarReader.prototype.read = function(position, length) {
+  var buffer = Buffer.alloc(length);
+  var bytesRead = fs.readSync(this.fd, buffer, 0, length, position);
+  return buffer.slice(0, bytesRead);
+};
+
+ColumnarReader.prototype.readIndex = function(size) {
+  if (size < HEADER_SIZE + TRAILER_SIZE) return false;
+  var trailer = this.read(size - TRAILER_SIZE, TRAILER_SIZE);
+  if (trailer.toString('ascii', 8) !== INDEX_MAGIC) return false;
+  var indexOffset = trailer.readUInt32LE(0) + trailer.readUInt32LE(4) * 0x100000000;
+  var cursor = new Cursor(this.read(indexOffset, size - TRAILER_SIZE - indexOffset));
+  if (cursor.byte() !== 0x49 /* 'I' */) return false;
+  var count = cursor.varint();
+  for (var i = 0; i < count; i++) {
+    var series = readSeries(cursor);
+    this.series[series.id] = series;
+  }
+  count = cursor.varint();
+  for (i = 0; i < count; i++) {
+    var chunk = { series: cursor.varint(), offset: cursor.varint() };
+    chunk.minTime = cursor.signed();
+    chunk.maxTime = chunk.minTime + cursor.varint();
+    chunk.rows = cursor.varint();
+    this.chunks.push(chunk);
+  }
+  this.complete = true;
+  return true;
+};
+
+// Rebuilds the index from the records of a file that was not closed
+ColumnarReader.prototype.scan = function(size) {
+  var position = HEADER_SIZE;
+  var headerSize = MAX_RECORD_HEADER;
+  while (position < size) {
+    var cursor = new Cursor(this.read(position, headerSize));
+    try {
+      var type = cursor.byte();
+      if (type === 0x53 /* 'S' */) {
+        var series = readSeries(cursor);
+        this.series[series.id] = series;
+        position += cursor.position;
+      } else if (type === 0x43 /* 'C' */) {
+        var chunk = { series: cursor.varint(), offset: position, rows: cursor.varint() };
+        chunk.minTime = cursor.signed();
+        chunk.maxTime = chunk.minTime + cursor.varint();
+        cursor.varint(); // raw length
+        var compressedLength = cursor.varint();
+        position += cursor.position + compressedLength;
+        // A chunk cut short by the process exiting is ignored
+        if (position <= size) this.chunks.push(chunk);
+      } else {
+        break;
+      }
+    } catch (err) {
+      if (position + headerSize >= size) {
+        // A truncated record at the end of the file
+        break;
+      }
+      // A series with long names, read it again
+      headerSize *= 2;
+      continue;
+    }
+    headerSize = MAX_RECORD_HEADER;
+  }
+};
+
+ColumnarReader.prototype.readChunk = function(chunk) {
+  var cursor = new Cursor(this.read(chunk.offset, MAX_RECORD_HEADER));
+  cursor.byte();
+  cursor.varint();
+  var rows = cursor.varint();
+  var minTime = cursor.signed();
+  cursor.varint();
+  cursor.varint();
+  var compressedLength = cursor.varint();
+  var data = zlib.inflateSync(this.read(chunk.offset + cursor.position, compressedLength));
+
+  cursor = new Cursor(data);
+  var times = new Array(rows);
+  var time = minTime;
+  for (var i = 0; i < rows; i++) {
+    time += cursor.signed();
+    times[i] = time;
+  }
+  var columns = [];
+  for (var c = 0; c < this.series[chunk.series].columns; c++) {
+    columns.push(decodeColumn(cursor, rows));
+  }
+  return { times: times, columns: columns };
+};
+
+// Returns [{id, source, name, columns, rows, from, to}]
+ColumnarReader.prototype.list = function() {
+  var summary = this.series.map(function(series) {
+    return {
+      id: series.id,
+      source: series.source,
+      name: series.name,
+      columns: series.columns,
+      rows: 0,
+      from: null,
+      to: null,
+    };
+  });
+  this.chunks.forEach(function(chunk) {
+    var entry = summary[chunk.series];
+    entry.rows += chunk.rows;
+    if (entry.from === null || chunk.minTime < entry.from) entry.from = chunk.minTime;
+    if (entry.to === null || chunk.maxTime > entry.to) entry.to = chunk.maxTime;
+  });
+  return summary;
+};
+
+ColumnarReader.prototype.sources = function() {
+  var sources = [];
+  this.series.forEach(function(series) {
+    if (sources.indexOf(series.source) === -1) sources.push(series.source);
+  });
+  return sources;
+};
+
+/*
+ * Returns the rows recorded for source (or every source if it is omitted)
+ * between from and to inclusive, in time order, as
+ *   {time, source, name, values}
+ * where values are the fields after the name.
+ */
+ColumnarReader.prototype.query = function(source, from, to) {
+  if (from === undefined || from === null) from = -Infinity;
+  if (to === undefined || to === null) to = Infinity;
+  var self = this;
+  var rows = [];
+  this.chunks.forEach(function(chunk) {
+    var series = self.series[chunk.series];
+    if ((source && series.source !== source) || chunk.maxTime < from || chunk.minTime > to) {
+      return;
+    }
+    var data = self.readChunk(chunk);
+    for (var i = 0; i < data.times.length; i++) {
+      var time = data.times[i];
+      if (time < from || time > to) continue;
+      var values = new Array(data.columns.length);
+      for (var c = 0; c < data.columns.length; c++) {
+        values[c] = data.columns[c][i];
+      }
+      rows.push({ time: time, source: series.source, name: series.name, values: values });
+    }
+  });
+  // Stable, so rows from the same payload stay in order
+  return rows
+    .map(function(row, i) {
+      return { row: row, i: i };
+    })
+    .sort(function(a, b) {
+      return a.row.time - b.row.time || a.i - b.i;
+    })
+    .map(function(entry) {
+      return entry.row;
+    });
+};
+
+// Rebuilds a row as the text line the plugin pushed
+ColumnarReader.line = function(row) {
+  // api lines are "topic:json", see src/recorder.cpp
+  if (row.source === 'api') return row.name + ':' + row.values[0];
+  return row.name === '' ? String(row.values[0]) : [row.name].concat(row.values).join(',');
+};
+
+ColumnarReader.prototype.close = function() {
+  if (this.fd !== null) {
+    fs.closeSync(this.fd);
+    this.fd = null;
+  }
+};
+
+module.exports = ColumnarReader;
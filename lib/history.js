@@ -0,0 +1,83 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+'use strict';
+
+/*
+ * Reads the history ring files written by src/history.cpp, for looking at
+ * the last minutes of a process after it has gone. A running process reads
+ * its own rings with agent.readHistory() instead.
+ */
+
+var fs = require('fs');
+
+var MAGIC = 'AMHR';
+var VERSION = 1;
+var HEADER_SIZE = 64;
+var RECORD_HEADER_SIZE = 16;
+
+// Must match the topic table in src/history.cpp
+var TOPICS = ['gc_node', 'loop_node', 'memory', 'memory_node', 'common_memory', 'cpu', 'common_cpu', 'api'];
+
+function readUInt64(buffer, offset) {
+  return buffer.readUInt32LE(offset) + buffer.readUInt32LE(offset + 4) * 0x100000000;
+}
+
+function align(size) {
+  return Math.ceil(size / 8) * 8;
+}
+
+// Copies length bytes from logical position in the ring, wrapping at the end
+function copyOut(buffer, capacity, position, length) {
+  var start = position % capacity;
+  var first = Math.min(length, capacity - start);
+  var result = Buffer.alloc(length);
+  buffer.copy(result, 0, HEADER_SIZE + start, HEADER_SIZE + start + first);
+  buffer.copy(result, first, HEADER_SIZE, HEADER_SIZE + length - first);
+  return result;
+}
+
+/*
+ * Returns the records in file written between from and to inclusive as
+ *   [{time, topic, data}]
+ * in the order they were written.
+ */
+module.exports.readFile = function(file, from, to) {
+  if (from === undefined || from === null) from = -Infinity;
+  if (to === undefined || to === null) to = Infinity;
+  var buffer = fs.readFileSync(file);
+  if (buffer.length < HEADER_SIZE || buffer.toString('ascii', 0, 4) !== MAGIC || buffer.readUInt32LE(4) !== VERSION) {
+    throw new Error(file + ' is not an appmetrics history file');
+  }
+  var capacity = readUInt64(buffer, 8);
+  var head = readUInt64(buffer, 16);
+  var tail = readUInt64(buffer, 24);
+  var records = [];
+  for (var position = tail; position < head; ) {
+    var header = copyOut(buffer, capacity, position, RECORD_HEADER_SIZE);
+    var length = header.readUInt32LE(0);
+    if (length > capacity) break;
+    var time = readUInt64(header, 8);
+    if (time >= from && time <= to && header[4] < TOPICS.length) {
+      records.push({
+        time: time,
+        topic: TOPICS[header[4]],
+        data: copyOut(buffer, capacity, position + RECORD_HEADER_SIZE, length).toString(),
+      });
+    }
+    position += align(RECORD_HEADER_SIZE + length);
+  }
+  return records;
+};
@@ -0,0 +1,91 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+'use strict';
+
+/*
+ * Incoming http and https requests seen through the diagnostics_channel
+ * events published by Node's http server, so the http and https probes don't
+ * need to patch Server.prototype.on or wrap each response's end().
+ *
+ * Both probes share one subscription to each channel, and requests are passed
+ * to the https probe if their socket is encrypted. The probe's context for a
+ * request is kept on the response between the two events. While neither
+ * probe is active nothing is subscribed, so the server doesn't publish.
+ */
+
+var semver = require('semver');
+
+// The http.server channels were added in 16.17.0 and 18.7.0
+var supported = semver.satisfies(process.version, '^16.17.0 || >=18.7.0');
+
+var kContext = Symbol('appmetricsHttpContext');
+
+var probes = { http: null, https: null };
+var subscribed = false;
+var requestStart = null;
+var responseFinish = null;
+
+function probeFor(message) {
+  return message.socket && message.socket.encrypted ? probes.https : probes.http;
+}
+
+function onRequestStart(message) {
+  var probe = probeFor(message);
+  if (probe === null) return;
+  var context = probe.serverRequestStart(message.request);
+  if (context !== undefined) message.response[kContext] = context;
+}
+
+function onResponseFinish(message) {
+  var response = message.response;
+  var context = response[kContext];
+  if (context === undefined) return;
+  response[kContext] = undefined;
+  var probe = probeFor(message);
+  if (probe === null) return;
+  probe.serverRequestEnd(context, message.request, response);
+}
+
+function update() {
+  var wanted = probes.http !== null || probes.https !== null;
+  if (wanted === subscribed) return;
+  if (requestStart === null) {
+    var diagnosticsChannel = require('diagnostics_channel');
+    requestStart = diagnosticsChannel.channel('http.server.request.start');
+    responseFinish = diagnosticsChannel.channel('http.server.response.finish');
+  }
+  if (wanted) {
+    requestStart.subscribe(onRequestStart);
+    responseFinish.subscribe(onResponseFinish);
+  } else {
+    requestStart.unsubscribe(onRequestStart);
+    responseFinish.unsubscribe(onResponseFinish);
+  }
+  subscribed = wanted;
+}
+
+module.exports.supported = supported;
+
+/*
+ * Set the probe, or null, to be passed requests of type 'http' or 'https'.
+ * The probe must provide serverRequestStart(req), returning a context or
+ * undefined to ignore the request, and serverRequestEnd(context, req, res).
+ */
+module.exports.setProbe = function(type, probe) {
+  if (!supported) return;
+  probes[type] = probe;
+  update();
+};
@@ -0,0 +1,82 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+'use strict';
+
+/*
+ * Lightweight http metrics: the http and https probes record each request's
+ * response time and status code into native per-route histograms (see
+ * src/httpsummary.cpp), which are emitted as periodic 'http-summary' events.
+ * The per-request 'http' events are only emitted as well if asked for.
+ */
+
+var agent = require('../appmetrics');
+
+var config = {
+  interval: 10000,
+  events: false,
+};
+
+// method -> url -> native route id, so each route is only resolved once.
+// Past the native limit on routes, further urls share an id and aren't cached.
+var MAX_ROUTES = 1000;
+var routes = new Map();
+var routeCount = 0;
+
+module.exports.enabled = false;
+module.exports.events = true;
+
+function update() {
+  agent.setHttpSummary(module.exports.enabled, config.interval, config.events);
+  module.exports.events = !module.exports.enabled || config.events;
+}
+
+module.exports.enable = function() {
+  module.exports.enabled = true;
+  update();
+};
+
+module.exports.disable = function() {
+  module.exports.enabled = false;
+  update();
+};
+
+module.exports.setConfig = function(newConfig) {
+  if (typeof newConfig.interval !== 'undefined') {
+    var interval = parseInt(newConfig.interval, 10);
+    if (!(interval > 0)) throw new Error('http-summary interval must be a positive number of milliseconds');
+    config.interval = interval;
+  }
+  if (typeof newConfig.events !== 'undefined') config.events = Boolean(newConfig.events);
+  if (module.exports.enabled) update();
+};
+
+// secure is true for the https probe's requests
+module.exports.record = function(method, url, duration, statusCode, secure) {
+  var urls = routes.get(method);
+  if (urls === undefined) {
+    urls = new Map();
+    routes.set(method, urls);
+  }
+  var id = urls.get(url);
+  if (id === undefined) {
+    id = agent.httpRoute(method, url);
+    if (routeCount < MAX_ROUTES) {
+      urls.set(url, id);
+      routeCount++;
+    }
+  }
+  agent.httpRecord(id, duration, statusCode, secure);
+};
@@ -0,0 +1,45 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+'use strict';
+
+/*
+ * Maps the name of a module to the files in the probes directory that
+ * instrument it, in the order they are attached. The name is the one each
+ * probe passes to Probe.call(this, name); tests/probe_files_tests.js checks
+ * that every probe is listed. The 'trace' probe is not, as it is attached to
+ * every module once enabled.
+ */
+module.exports = new Map([
+  ['axon', ['axon-probe.js']],
+  ['basho-riak-client', ['basho-riak-client-probe.js']],
+  ['http', ['http-outbound-probe.js', 'http-probe.js']],
+  ['https', ['https-outbound-probe.js', 'https-probe.js']],
+  ['leveldown', ['leveldown-probe.js']],
+  ['loopback-datasource-juggler', ['loopback-probe.js']],
+  ['memcached', ['memcached-probe.js']],
+  ['mongodb', ['mongo-probe.js']],
+  ['mqlight', ['mqlight-probe.js']],
+  ['mqtt', ['mqtt-probe.js']],
+  ['mysql', ['mysql-probe.js']],
+  ['oracle', ['oracle-probe.js']],
+  ['oracledb', ['oracledb-probe.js']],
+  ['pg', ['postgres-probe.js']],
+  ['redis', ['redis-probe.js']],
+  ['socket.io', ['socketio-probe.js']],
+  ['strong-express-metrics', ['strong-express-metrics-probe.js']],
+  ['strong-mq', ['strong-mq-probe.js']],
+  ['strong-oracle', ['strongoracle-probe.js']],
+]);
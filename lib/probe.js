@@ -15,20 +15,19 @@
  *******************************************************************************/
 'use strict';
 
+var aspect = require('./aspect.js');
 var timer = require('./timer.js');
 
-// Default to metrics on once probe has been started
-var _enabled = true;
-
-// Default to requests off
-var _requestsEnabled = false;
-
-// Not running by default
-var _started = false;
-
 function Probe(name) {
   this.name = name;
   this.config = {};
+  // Default to metrics on and requests off, once the probe has been started
+  this.enabled = true;
+  this.requestsEnabled = false;
+  this.started = false;
+  // Whether the probe's patches are installed
+  this.active = false;
+  this.patches = [];
 }
 
 /*
@@ -38,6 +37,29 @@ Probe.prototype.attach = function(name, target) {
   return target;
 };
 
+/*
+ * Called by aspect.js for each method patched while this probe is attaching
+ */
+Probe.prototype.addPatch = function(patch) {
+  this.patches.push(patch);
+  if (!this.active) aspect.unwrap([patch]);
+};
+
+/*
+ * Install or remove the probe's patches, so that a probe which is stopped
+ * or has nothing enabled costs nothing on the patched paths
+ */
+Probe.prototype.updatePatches = function() {
+  var active = this.started && (this.enabled || this.requestsEnabled);
+  if (active === this.active) return;
+  this.active = active;
+  if (active) {
+    aspect.rewrap(this.patches);
+  } else {
+    aspect.unwrap(this.patches);
+  }
+};
+
 /*
  * Set configuration by merging passed in config with current one
  */
@@ -76,6 +98,16 @@ Probe.prototype.requestStart = function(req, res, am) {};
 
 Probe.prototype.requestEnd = function(req, res, am) {};
 
+/*
+ * Stop the request and drop the probe's reference to it, as once stopped it
+ * may be recycled for another request (see lib/request.js), which a second
+ * requestEnd for the same call would otherwise stop
+ */
+Probe.prototype.endRequest = function(probeData) {
+  this.requestEnd.apply(this, arguments);
+  if (probeData) probeData.req = undefined;
+};
+
 /*
  * Default to metrics off until started
  */
@@ -89,50 +121,57 @@ Probe.prototype.requestProbeStart = function(req, res, am) {};
 Probe.prototype.requestProbeEnd = function(req, res, am) {};
 
 Probe.prototype.enableRequests = function() {
-  _requestsEnabled = true;
-  if (_started) {
+  this.requestsEnabled = true;
+  if (this.started) {
     this.requestProbeStart = this.requestStart;
-    this.requestProbeEnd = this.requestEnd;
+    this.requestProbeEnd = this.endRequest;
   }
+  this.updatePatches();
 };
 
 Probe.prototype.disableRequests = function() {
-  _requestsEnabled = false;
+  this.requestsEnabled = false;
   this.requestProbeStart = function() {};
   this.requestProbeEnd = function() {};
+  this.updatePatches();
 };
 
 Probe.prototype.enable = function() {
-  _enabled = true;
-  if (_started) {
+  this.enabled = true;
+  if (this.started) {
     this.metricsProbeStart = this.metricsStart;
     this.metricsProbeEnd = this.metricsEnd;
   }
+  this.updatePatches();
 };
 
 Probe.prototype.disable = function() {
+  this.enabled = false;
   this.metricsProbeStart = function() {};
   this.metricsProbeEnd = function() {};
+  this.updatePatches();
 };
 
 Probe.prototype.start = function() {
-  _started = true;
-  if (_enabled) {
+  this.started = true;
+  if (this.enabled) {
     this.metricsProbeStart = this.metricsStart;
     this.metricsProbeEnd = this.metricsEnd;
   }
-  if (_requestsEnabled) {
+  if (this.requestsEnabled) {
     this.requestProbeStart = this.requestStart;
-    this.requestProbeEnd = this.requestEnd;
+    this.requestProbeEnd = this.endRequest;
   }
+  this.updatePatches();
 };
 
 Probe.prototype.stop = function() {
-  _started = false;
+  this.started = false;
   this.metricsProbeStart = function() {};
   this.metricsProbeEnd = function() {};
   this.requestProbeStart = function() {};
   this.requestProbeEnd = function() {};
+  this.updatePatches();
 };
 
 module.exports = Probe;
@@ -16,10 +16,60 @@
 'use strict';
 
 var timer = require('./timer.js');
-var util = require('util');
-var domain = require('domain');
 var am = require('../');
 
+/*
+ * Request Context
+ *
+ * Each root request has a store, { currentRequest }, that follows it across
+ * async calls so nested requests find their parent. AsyncLocalStorage keeps
+ * this with a constant cost per async hop; without it a domain is used, which
+ * also wraps every EventEmitter and callback so is only loaded if needed.
+ */
+var AsyncLocalStorage;
+try {
+  AsyncLocalStorage = require('async_hooks').AsyncLocalStorage;
+} catch (err) {
+  // Node.js 6 has no async_hooks
+}
+var requestContext;
+
+if (typeof AsyncLocalStorage === 'function') {
+  var storage = new AsyncLocalStorage();
+  requestContext = {
+    current: function() {
+      return storage.getStore();
+    },
+    enter: function() {
+      var store = { currentRequest: undefined, outer: storage.getStore() };
+      storage.enterWith(store);
+      return store;
+    },
+    exit: function(store) {
+      // Drop the link so stores left on reused resources, such as a
+      // keep-alive socket, don't chain together
+      var outer = store.outer;
+      store.outer = undefined;
+      storage.enterWith(outer);
+    },
+  };
+} else {
+  var domain = require('domain');
+  requestContext = {
+    current: function() {
+      return process.domain;
+    },
+    enter: function() {
+      var reqDomain = domain.create();
+      reqDomain.enter();
+      return reqDomain;
+    },
+    exit: function(store) {
+      store.exit();
+    },
+  };
+}
+
 /*
  * Global Request Tracking
  *
@@ -33,18 +83,48 @@ var am = require('../');
 var nextRequestId = 1;
 var nextEventId = 1;
 
-function Request(type, name, root) {
+/*
+ * Requests are pooled along with the timers they started. Once the request
+ * event for a root request has been emitted the tree is handed back for
+ * reuse. By default that only happens when nothing listens for request
+ * events, as a listener may keep the request; recycle: true says listeners
+ * copy what they need. Probes drop their reference when they end a request
+ * (see Probe.prototype.endRequest).
+ */
+var MAX_POOL_SIZE = 1024;
+var pool = [];
+
+function Request() {
   this.children = [];
+  // The frames captured by traceStop are only formatted when stack is read
+  Object.defineProperty(this, 'frames', { value: undefined, writable: true });
+  Object.defineProperty(this, 'formattedStack', { value: undefined, writable: true });
+  // Only timers the request started are pooled with it, not a probe's
+  Object.defineProperty(this, 'ownTimer', { value: false, writable: true });
+  Object.defineProperty(this, 'stack', { get: getStack, set: setStack, enumerable: true });
+}
+
+Request.prototype.init = function(type, name, root) {
   this.name = name;
   this.type = type;
+  this.parent = undefined;
+  this.top = undefined;
+  this.timer = undefined;
+  this.ownTimer = false;
+  this.context = undefined;
+  this.stack = undefined;
+  this.active = false;
+  this.orphaned = false;
+  this.tracedStart = false;
+  this.traceStopped = false;
 
   if (root === true) {
-    var reqDomain = domain.create();
-    reqDomain.enter();
+    requestContext.enter();
   }
 
-  if (process.domain) {
-    this.parent = process.domain.currentRequest;
+  var store = requestContext.current();
+  if (store) {
+    this.parent = store.currentRequest;
   }
   this.id = nextEventId;
   ++nextEventId;
@@ -59,6 +139,32 @@ function Request(type, name, root) {
       ++nextRequestId;
     }
   }
+};
+
+function newRequest(type, name, root) {
+  var req = pool.length > 0 ? pool.pop() : new Request();
+  req.init(type, name, root);
+  return req;
+}
+
+function shouldRecycle() {
+  if (typeof config.recycle === 'boolean') return config.recycle;
+  return typeof am.api === 'undefined' || am.api.listenerCount('request') === 0;
+}
+
+function recycle(req) {
+  for (var i = 0; i < req.children.length; i++) {
+    // Children stopped by their parent may still be held by their probe
+    if (!req.children[i].orphaned) recycle(req.children[i]);
+  }
+  req.children.length = 0;
+  if (req.ownTimer) timer.release(req.timer);
+  req.timer = undefined;
+  req.parent = undefined;
+  req.top = undefined;
+  req.context = undefined;
+  req.stack = undefined;
+  if (pool.length < MAX_POOL_SIZE) pool.push(req);
 }
 
 Request.prototype.traceStart = function() {
@@ -75,7 +181,7 @@ Request.prototype.traceStop = function() {
   if (!this.traceStopped) {
     this.traceStopped = true;
     if (config.minClockStack != -1 && this.timer.timeDelta >= config.minClockStack) {
-      this.stack = this.fetchStack();
+      this.frames = captureFrames();
     }
   }
 };
@@ -84,9 +190,11 @@ Request.prototype.start = function() {
   this.active = true;
   if (!this.timer) {
     this.timer = timer.start();
+    this.ownTimer = true;
   }
-  if (process.domain) {
-    process.domain.currentRequest = this;
+  var store = requestContext.current();
+  if (store) {
+    store.currentRequest = this;
   }
 };
 
@@ -100,67 +208,246 @@ Request.prototype.stop = function(context) {
     this.active = false;
     this.timer.stop();
     this.children.forEach(function(c) {
-      c.stop();
+      if (c.active) {
+        c.orphaned = true;
+        c.stop();
+      }
     });
 
     if (config.minClockTrace != -1 && this.timer.timeDelta >= config.minClockTrace) {
       this.traceStart(); // delayed start tracing (will call parent tracing if needed)
       this.traceStop();
     }
-    if (process.domain) {
-      process.domain.currentRequest = this.parent;
-      if (typeof process.domain.currentRequest === 'undefined') {
-        // End of a root request, so raise a request event
-        process.domain.exit();
-        am.emit('request', {
-          time: this.timer.startTimeMillis,
-          type: this.type,
-          name: this.name,
-          duration: this.timer.timeDelta,
-          request: this,
-        });
+    var store = requestContext.current();
+    if (store) {
+      store.currentRequest = this.parent;
+      if (typeof store.currentRequest === 'undefined') {
+        // End of a root request, so raise a request event unless sampled out
+        requestContext.exit(store);
+        finish(this);
       }
     }
   }
 };
 
-Request.prototype.fetchStack = function(cfg) {
-  //	Originally only if methodTrace enabled
+/*
+ * Stack Capture
+ *
+ * Stacks are captured as V8 CallSites and kept as frames from an interned
+ * table, so a frame seen before costs one lookup and its formatted line is
+ * shared. They are formatted when a consumer reads request.stack.
+ */
+var MAX_FRAMES = 10000;
+var frameTable = new Map();
+
+function Frame(callSite) {
+  this.functionName = callSite.getFunctionName();
+  this.isConstructor = callSite.isConstructor();
+  this.typeName = callSite.isToplevel() || this.isConstructor ? null : callSite.getTypeName();
+  this.fileName = callSite.getFileName();
+  this.lineNumber = callSite.getLineNumber();
+  this.columnNumber = callSite.getColumnNumber();
+  this.line = undefined;
+}
+
+// Formats as at type.function(file:line), with <module> and <root> when not known
+// and constructors as <module>.new function, as V8's own stack lines convert to
+Frame.prototype.format = function() {
+  if (this.line === undefined) {
+    var name = this.functionName;
+    if (name && this.isConstructor) {
+      name = '<module>.new ' + name;
+    } else if (!name) {
+      name = '<module>.<root>';
+    } else {
+      if (this.typeName && name.indexOf(this.typeName + '.') !== 0) name = this.typeName + '.' + name;
+      if (name.indexOf('.') === -1) name = '<module>.' + name;
+    }
+    this.line = 'at ' + name + '(' + this.fileName + ':' + this.lineNumber + ')';
+  }
+  return this.line;
+};
+
+function internFrame(callSite) {
+  var key = callSite.getFileName() + ':' + callSite.getLineNumber() + ':' + callSite.getColumnNumber();
+  var frame = frameTable.get(key);
+  if (frame === undefined) {
+    frame = new Frame(callSite);
+    if (frameTable.size < MAX_FRAMES) frameTable.set(key, frame);
+  }
+  return frame;
+}
+
+function isNotDeepDiveFrame(callSite) {
+  var fileName = callSite.getFileName() || '';
+  return fileName.indexOf('appmetrics') == -1 && fileName.indexOf('lib/aspect.js') == -1;
+}
+
+function prepareFrames(error, callSites) {
+  var frames = [];
+  for (var i = 0; i < callSites.length; i++) {
+    if (isNotDeepDiveFrame(callSites[i])) frames.push(internFrame(callSites[i]));
+  }
+  return frames;
+}
+
+function captureFrames() {
   var oldLimit = Error.stackTraceLimit;
+  var oldPrepare = Error.prepareStackTrace;
   Error.stackTraceLimit = 15;
+  Error.prepareStackTrace = prepareFrames;
   var trace = {};
-  Error.captureStackTrace(trace);
+  Error.captureStackTrace(trace, captureFrames);
+  var frames = trace.stack;
+  Error.prepareStackTrace = oldPrepare;
   Error.stackTraceLimit = oldLimit;
-  var lines = trace.stack.split('\n');
-  return lines.filter(isNotDeepDiveStack).map(convertLine).join('\n');
+  return Array.isArray(frames) ? frames : undefined;
+}
+
+function getStack() {
+  if (this.formattedStack === undefined && this.frames !== undefined) {
+    this.formattedStack = this.frames
+      .map(function(frame) {
+        return frame.format();
+      })
+      .join('\n');
+  }
+  return this.formattedStack;
+}
+
+function setStack(stack) {
+  this.frames = undefined;
+  this.formattedStack = stack;
+}
+
+// Returns copies of the captured frames, as the frames themselves are shared
+// between requests, as {functionName, typeName, fileName, lineNumber, columnNumber}
+Request.prototype.getStackFrames = function() {
+  if (!this.frames) return undefined;
+  return this.frames.map(function(frame) {
+    return {
+      functionName: frame.functionName,
+      typeName: frame.typeName,
+      fileName: frame.fileName,
+      lineNumber: frame.lineNumber,
+      columnNumber: frame.columnNumber,
+    };
+  });
+};
+
+/*
+ * Sampling
+ *
+ * Head sampling decides when a root request starts whether its tree is built
+ * at all, keeping sampleRate of them. The rest, and everything started within
+ * them, get a stand in that does nothing but keep the context.
+ *
+ * Tail sampling then decides which of the built trees are emitted. With
+ * keepSlowest set, only the slowest keepSlowest requests in each keepInterval
+ * are emitted, at the end of the interval, along with every failed request,
+ * which are emitted as they finish.
+ */
+function Unsampled(store) {
+  this.store = store;
+}
+
+Unsampled.prototype.start = function() {};
+
+Unsampled.prototype.setContext = function() {};
+
+Unsampled.prototype.stop = function() {
+  if (this.store) {
+    requestContext.exit(this.store);
+    this.store = undefined;
+  }
 };
 
-function isNotDeepDiveStack(line) {
-  return line.indexOf('appmetrics') == -1 && line.indexOf('lib/aspect.js') == -1;
+// Stands in for everything started within an unsampled root request
+var UNSAMPLED = new Unsampled();
+
+function unsampled(root) {
+  if (root === true) {
+    if (!(config.sampleRate < 1) || Math.random() < config.sampleRate) return null;
+    var store = requestContext.enter();
+    store.currentRequest = UNSAMPLED;
+    return new Unsampled(store);
+  }
+  var current = requestContext.current();
+  return current && current.currentRequest === UNSAMPLED ? UNSAMPLED : null;
+}
+
+var kept = [];
+var keepTimer = null;
+var keepTimerInterval = 0;
+
+function failed(req) {
+  return Boolean(req.context && (req.context.statusCode >= 500 || req.context.error));
+}
+
+function emitRequest(req) {
+  am.emit('request', {
+    time: req.timer.startTimeMillis,
+    type: req.type,
+    name: req.name,
+    duration: req.timer.timeDelta,
+    request: req,
+  });
+  if (shouldRecycle()) recycle(req);
+}
+
+function discard(req) {
+  if (config.recycle !== false) recycle(req);
 }
 
-var fullStackRegex = /at (.*)\.(.*) \(((.*)(:\d*)(:\d*))\)/;
-var onlyFuncStackRegex = /at (.*) \(((.*)(:\d*)(:\d*))\)/;
-var onlyFileStackRegex = /at ((.*)(:\d*)(:\d*))/;
-var stackFormat = 'at %s.%s(%s%s)';
-function convertLine(line) {
-  var m = fullStackRegex.exec(line);
-  if (m) {
-    return util.format(stackFormat, m[1], m[2], m[4], m[5]);
+// Called when a root request stops
+function finish(req) {
+  if (!(config.keepSlowest > 0) || failed(req)) {
+    emitRequest(req);
+    return;
   }
-  m = onlyFuncStackRegex.exec(line);
-  if (m) {
-    return util.format(stackFormat, '<module>', m[1], m[3], m[4]);
+  if (kept.length < config.keepSlowest) {
+    kept.push(req);
+    return;
   }
-  m = onlyFileStackRegex.exec(line);
-  if (m) {
-    return util.format(stackFormat, '<module>', '<root>', m[2], m[3]);
+  var fastest = 0;
+  for (var i = 1; i < kept.length; i++) {
+    if (kept[i].timer.timeDelta < kept[fastest].timer.timeDelta) fastest = i;
+  }
+  if (req.timer.timeDelta > kept[fastest].timer.timeDelta) {
+    discard(kept[fastest]);
+    kept[fastest] = req;
+  } else {
+    discard(req);
+  }
+}
+
+function emitKept() {
+  var requests = kept;
+  kept = [];
+  requests.sort(function(a, b) {
+    return a.timer.startTimeMillis - b.timer.startTimeMillis;
+  });
+  requests.forEach(emitRequest);
+}
+
+// The requests kept so far are emitted whenever the interval changes
+function updateKeepTimer() {
+  var interval = config.keepSlowest > 0 ? config.keepInterval : 0;
+  if (interval === keepTimerInterval) return;
+  if (keepTimer) clearInterval(keepTimer);
+  keepTimer = null;
+  keepTimerInterval = interval;
+  emitKept();
+  if (interval > 0) {
+    keepTimer = setInterval(emitKept, interval);
+    keepTimer.unref();
   }
-  return line;
 }
 
 exports.startRequest = function(type, name, root, eventTimer) {
-  var req = new Request(type, name, root);
+  var stub = unsampled(root);
+  if (stub) return stub;
+  var req = newRequest(type, name, root);
   if (eventTimer) {
     req.timer = eventTimer;
   }
@@ -169,7 +456,9 @@ exports.startRequest = function(type, name, root, eventTimer) {
 };
 
 exports.startMethod = function(name, eventTimer) {
-  var req = new Request(null, name);
+  var stub = unsampled(false);
+  if (stub) return stub;
+  var req = newRequest(null, name);
   if (eventTimer) {
     req.timer = eventTimer;
   }
@@ -177,11 +466,18 @@ exports.startMethod = function(name, eventTimer) {
   return req;
 };
 
+var DEFAULT_KEEP_INTERVAL = 10000;
+var MAX_KEEP_INTERVAL = 0x7fffffff;
+
 var config = {
   minClockTrace: 0,
   minCpuTrace: 0,
   minCpuStack: 0,
   minClockStack: -1,
+  recycle: undefined,
+  sampleRate: 1,
+  keepSlowest: 0,
+  keepInterval: DEFAULT_KEEP_INTERVAL,
 };
 
 exports.setConfig = function(newConfig) {
@@ -193,4 +489,10 @@ exports.setConfig = function(newConfig) {
       config[prop] = newConfig[prop];
     }
   }
+  // setInterval would treat anything else as 1ms
+  config.keepInterval = Number(config.keepInterval);
+  if (!(config.keepInterval > 0 && config.keepInterval <= MAX_KEEP_INTERVAL)) {
+    config.keepInterval = DEFAULT_KEEP_INTERVAL;
+  }
+  updateKeepTimer();
 };
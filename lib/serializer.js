@@ -17,106 +17,115 @@
 
 /*
  * Allow objects with circularities to be flattened/serialized.
- * This is achieved by replacing references to already seen objects with 'CIRCULAR-' + id
+ * This is achieved by replacing references to already seen objects with 'CIRCULAR-' + id,
+ * where id is the idCount written at the start of the object when it was first seen.
  */
 var CIRCULAR = 'CIRCULAR-';
 
-exports.serialize = function(obj, objCache, id) {
-  var newObj = {};
+/*
+ * Copies obj in a single pass, giving each object an idCount in the order it
+ * is first seen and replacing later references to it with CIRCULAR + id.
+ * Objects are looked up in a Map, so the cost is linear in the number of
+ * objects. Arrays aren't given ids, so the ones being copied are tracked to
+ * stop cycles through them.
+ */
+function Copier() {
+  this.ids = new Map();
+  this.arrays = new Set();
+}
 
-  /*
-   * Add the head object to the cache
-   */
-  if (typeof objCache === 'undefined') {
-    objCache = [];
-    objCache.push(obj);
-    newObj.idCount = 0;
+Copier.prototype.copyValue = function(value) {
+  if (typeof value !== 'object' || value === null || typeof value.toJSON === 'function') {
+    return value;
   }
-
-  if (typeof id !== 'undefined') {
-    newObj.idCount = id;
+  if (Array.isArray(value)) {
+    return this.copyArray(value);
   }
-  /*
-   * Walk values in object
-   */
-  for (var prop in obj) {
-    if (obj.hasOwnProperty(prop)) {
-      /*
-       * Need to find object references
-       */
-      if (typeof obj[prop] === 'object' && obj[prop] !== null) {
-        /*
-         * Check if its an array
-         */
-        if (Array.isArray(obj[prop])) {
-          if (obj[prop].length == 0) {
-            newObj[prop] = obj[prop];
-          } else {
-            newObj[prop] = [];
-            for (var idx = 0; idx < obj[prop].length; idx++) {
-              id = objCache.indexOf(obj[prop][idx]);
-              if (id > -1) {
-                /*
-                 * Found an entry, so replace obj[prop] with a reference
-                 */
-                newObj[prop][idx] = CIRCULAR + id;
-              } else {
-                /*
-                 * Not found, so push it to the cache and serialize
-                 */
-
-                objCache.push(obj[prop][idx]);
-                newObj[prop][idx] = exports.serialize(obj[prop][idx], objCache, objCache.indexOf(obj[prop][idx]));
-              }
-            }
-          }
-        } else {
-          // Got a normal object. Check to see if we've seen it before
-          id = objCache.indexOf(obj[prop]);
-          if (id > -1) {
-            // Found an entry, so replace obj[prop] with a reference
-            newObj[prop] = CIRCULAR + id;
-          } else {
-            // Not found, so push it to the cache and serialize
+  var id = this.ids.get(value);
+  if (id !== undefined) {
+    return CIRCULAR + id;
+  }
+  return this.copyObject(value);
+};
 
-            objCache.push(obj[prop]);
-            newObj[prop] = exports.serialize(obj[prop], objCache, objCache.indexOf(obj[prop]));
-          }
-        }
-      } else {
-        newObj[prop] = obj[prop];
-      }
-    }
+Copier.prototype.copyObject = function(obj) {
+  var id = this.ids.size;
+  this.ids.set(obj, id);
+  var copy = { idCount: id };
+  var keys = Object.keys(obj);
+  for (var i = 0; i < keys.length; i++) {
+    copy[keys[i]] = this.copyValue(obj[keys[i]]);
   }
-  if (newObj.idCount == 0) {
-    return JSON.stringify(newObj);
-  } else {
-    return newObj;
+  return copy;
+};
+
+Copier.prototype.copyArray = function(array) {
+  if (this.arrays.has(array)) return null;
+  this.arrays.add(array);
+  var copy = new Array(array.length);
+  for (var i = 0; i < array.length; i++) {
+    copy[i] = this.copyValue(array[i]);
   }
+  this.arrays.delete(array);
+  return copy;
 };
 
 /*
- * Reverse the serialization, inflating CIRCULAR + id to a reference to the object
+ * Returns obj as a JSON string. The copy is written by JSON.stringify, which
+ * is faster than building the string up in JavaScript.
  */
-exports.deserialize = function(obj, objCache) {
+exports.serialize = function(obj) {
+  return JSON.stringify(new Copier().copyValue(obj));
+};
+
+// Returns the id in a 'CIRCULAR-' + id reference, or -1 if value isn't one
+function referenceId(value) {
+  if (value.length <= CIRCULAR.length || !value.startsWith(CIRCULAR)) return -1;
+  var id = 0;
+  for (var i = CIRCULAR.length; i < value.length; i++) {
+    var digit = value.charCodeAt(i) - 48;
+    if (digit < 0 || digit > 9) return -1;
+    id = id * 10 + digit;
+  }
+  return id;
+}
+
+/*
+ * Reverse the serialization, inflating CIRCULAR + id to a reference to the object.
+ * The objects are walked iteratively in the order they were written, so each
+ * reference is to an object that has already been seen.
+ */
+exports.deserialize = function(obj) {
   if (typeof obj === 'string') {
     obj = JSON.parse(obj);
   }
-  if (typeof objCache === 'undefined') {
-    objCache = [];
-  }
-  var idCount = obj.idCount;
-  delete obj.idCount;
-  objCache[idCount] = obj;
+  if (typeof obj !== 'object' || obj === null) return obj;
 
-  for (var prop in obj) {
-    if (typeof obj[prop] === 'object' && obj[prop] !== null) {
-      exports.deserialize(obj[prop], objCache);
+  var objCache = [];
+  // Each frame is an object or array, its keys and the index of the next key
+  var stack = [{ obj: obj, keys: null, index: 0 }];
+  while (stack.length > 0) {
+    var frame = stack[stack.length - 1];
+    var current = frame.obj;
+    if (frame.keys === null) {
+      if (!Array.isArray(current) && typeof current.idCount === 'number') {
+        objCache[current.idCount] = current;
+        delete current.idCount;
+      }
+      frame.keys = Object.keys(current);
+    }
+    if (frame.index === frame.keys.length) {
+      stack.pop();
+      continue;
     }
-    if (typeof obj[prop] === 'string') {
-      if (obj[prop].indexOf(CIRCULAR) === 0) {
-        var index = obj[prop].substring(9, obj[prop].length);
-        obj[prop] = objCache[index];
+    var key = frame.keys[frame.index++];
+    var value = current[key];
+    if (typeof value === 'object' && value !== null) {
+      stack.push({ obj: value, keys: null, index: 0 });
+    } else if (typeof value === 'string') {
+      var id = referenceId(value);
+      if (id !== -1 && id < objCache.length) {
+        current[key] = objCache[id];
       }
     }
   }
@@ -0,0 +1,248 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+'use strict';
+
+/*
+ * A size-capped directory of heap snapshots.
+ *
+ * Snapshots are written to a temporary name and renamed into place once
+ * complete, so a partially written file is never mistaken for a snapshot.
+ * A manifest.json in the directory records pid, time, heap used and trigger
+ * for each snapshot; the oldest snapshots are removed whenever the store
+ * grows past maxFiles or maxTotalSize.
+ */
+
+var fs = require('fs');
+var path = require('path');
+
+var MANIFEST = 'manifest.json';
+var SUFFIX = '.heapsnapshot';
+var TMP_SUFFIX = SUFFIX + '.tmp';
+
+var defaults = {
+  maxFiles: 5,
+  maxTotalSize: 0, // bytes, 0 for no limit
+  heapUsedThreshold: 0, // bytes, 0 to disable automatic snapshots
+  minInterval: 5 * 60 * 1000, // ms between automatic snapshots
+};
+
+function isRunning(pid) {
+  try {
+    process.kill(pid, 0);
+    return true;
+  } catch (e) {
+    return e.code === 'EPERM';
+  }
+}
+
+/*
+ * writeSnapshot has the signature of heapdump.writeSnapshot(filename, callback)
+ */
+function SnapshotStore(writeSnapshot, options) {
+  this.writeSnapshot = writeSnapshot;
+  this.busy = false;
+  this.lastAutomatic = 0;
+  this.configure(options);
+}
+
+SnapshotStore.prototype.configure = function(options) {
+  options = options || {};
+  if (typeof options.directory !== 'string' || options.directory === '') {
+    throw new TypeError('heapdump directory must be a non-empty string');
+  }
+  this.directory = path.resolve(options.directory);
+  for (var key in defaults) {
+    var value = typeof options[key] === 'undefined' ? defaults[key] : Number(options[key]);
+    if (!(value >= 0)) {
+      throw new RangeError('heapdump ' + key + ' must be a non-negative number');
+    }
+    this[key] = value;
+  }
+  if (this.maxFiles < 1) {
+    throw new RangeError('heapdump maxFiles must be at least 1');
+  }
+  mkdirp(this.directory);
+  this.removeStaleTemporaries();
+  this.update(function() {});
+};
+
+function mkdirp(dir) {
+  try {
+    fs.mkdirSync(dir);
+  } catch (e) {
+    if (e.code === 'EEXIST') return;
+    if (e.code !== 'ENOENT') throw e;
+    mkdirp(path.dirname(dir));
+    fs.mkdirSync(dir);
+  }
+}
+
+// Temporaries left behind by processes that died while writing a snapshot.
+SnapshotStore.prototype.removeStaleTemporaries = function() {
+  var dir = this.directory;
+  fs.readdirSync(dir).forEach(function(file) {
+    if (file.slice(-TMP_SUFFIX.length) !== TMP_SUFFIX) return;
+    var pid = parseInt(file.split('-')[1]);
+    if (pid === process.pid || (pid > 0 && isRunning(pid))) return;
+    try {
+      fs.unlinkSync(path.join(dir, file));
+    } catch (e) {
+      // already gone
+    }
+  });
+};
+
+SnapshotStore.prototype.readManifest = function() {
+  var entries;
+  try {
+    entries = JSON.parse(fs.readFileSync(path.join(this.directory, MANIFEST), 'utf8')).snapshots;
+  } catch (e) {
+    entries = [];
+  }
+  if (!Array.isArray(entries)) entries = [];
+  var dir = this.directory;
+  // Drop entries whose files have been removed by hand
+  return entries.filter(function(entry) {
+    return entry && typeof entry.file === 'string' && fs.existsSync(path.join(dir, entry.file));
+  });
+};
+
+SnapshotStore.prototype.writeManifest = function(entries) {
+  var file = path.join(this.directory, MANIFEST);
+  var tmp = file + '.' + process.pid + '.tmp';
+  fs.writeFileSync(tmp, JSON.stringify({ snapshots: entries }, null, 2));
+  fs.renameSync(tmp, file);
+};
+
+/*
+ * Re-reads the manifest, optionally adds an entry, removes the oldest
+ * snapshots until the limits are met and writes the manifest back.
+ * Calls back with an error if the added entry itself had to be removed.
+ */
+SnapshotStore.prototype.update = function(added, callback) {
+  if (typeof added === 'function') {
+    callback = added;
+    added = null;
+  }
+  var entries = this.readManifest();
+  if (added) entries.push(added);
+  entries.sort(function(a, b) {
+    return a.time - b.time;
+  });
+  var total = entries.reduce(function(sum, entry) {
+    return sum + entry.size;
+  }, 0);
+  var err = null;
+  while (entries.length > this.maxFiles || (this.maxTotalSize > 0 && total > this.maxTotalSize)) {
+    var oldest = entries.shift();
+    total -= oldest.size;
+    if (oldest === added) {
+      err = new Error('heap snapshot of ' + added.size + ' bytes exceeds maxTotalSize and was removed');
+    }
+    try {
+      fs.unlinkSync(path.join(this.directory, oldest.file));
+    } catch (e) {
+      // already gone
+    }
+  }
+  try {
+    this.writeManifest(entries);
+  } catch (e) {
+    err = err || e;
+  }
+  callback(err, entries);
+};
+
+/*
+ * Write a snapshot into the store. trigger is recorded in the manifest
+ * ('manual', 'signal' or 'threshold'). The callback receives the manifest
+ * entry for the new snapshot. Returns false if the snapshot could not be
+ * started, as heapdump.writeSnapshot does.
+ */
+SnapshotStore.prototype.write = function(trigger, callback) {
+  callback = callback || function() {};
+  if (this.busy) {
+    callback(new Error('a heap snapshot is already being written'));
+    return false;
+  }
+  var self = this;
+  var now = Date.now();
+  var name = 'heapdump-' + process.pid + '-' + now;
+  var tmp = path.join(this.directory, name + TMP_SUFFIX);
+  var entry = {
+    file: name + SUFFIX,
+    pid: process.pid,
+    time: now,
+    heapUsed: process.memoryUsage().heapUsed,
+    trigger: trigger,
+    size: 0,
+  };
+
+  this.busy = true;
+  var completed = false;
+  var removeTmp = function() {
+    try {
+      fs.unlinkSync(tmp);
+    } catch (e) {
+      // nothing to clean up
+    }
+  };
+  var started = this.writeSnapshot(tmp, function(err) {
+    completed = true;
+    self.busy = false;
+    if (err) {
+      // e.g. the forked child was killed part way through
+      removeTmp();
+      return callback(err);
+    }
+    try {
+      entry.size = fs.statSync(tmp).size;
+      fs.renameSync(tmp, path.join(self.directory, entry.file));
+    } catch (e) {
+      removeTmp();
+      return callback(e);
+    }
+    entry.duration = Date.now() - now;
+    self.update(entry, function(err) {
+      callback(err, entry);
+    });
+  });
+  if (started === false) {
+    this.busy = false;
+    // The writer may already have called back with the reason
+    if (!completed) callback(new Error('unable to start writing a heap snapshot'));
+    return false;
+  }
+  return true;
+};
+
+/*
+ * Called with each 'gc' event; writes a snapshot when heap used crosses
+ * heapUsedThreshold, at most once every minInterval ms.
+ */
+SnapshotStore.prototype.onGC = function(gc) {
+  if (this.heapUsedThreshold <= 0 || gc.used < this.heapUsedThreshold) return;
+  var now = Date.now();
+  if (this.busy || now - this.lastAutomatic < this.minInterval) return;
+  this.lastAutomatic = now;
+  this.write('threshold');
+};
+
+SnapshotStore.prototype.list = function() {
+  return this.readManifest();
+};
+
+module.exports = SnapshotStore;
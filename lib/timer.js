@@ -15,21 +15,64 @@
  *******************************************************************************/
 'use strict';
 
+/*
+ * Clock for timing events, in milliseconds. performance.now() is a plain
+ * number so reading it doesn't allocate, and adding it to performance.timeOrigin
+ * gives the wall clock time without calling Date.now() for every event.
+ */
+var now;
+var epoch;
+var performance;
+try {
+  performance = require('perf_hooks').performance;
+} catch (err) {
+  // Node.js 6 has no perf_hooks
+}
+if (performance && typeof performance.now === 'function' && performance.timeOrigin) {
+  now = function() {
+    return performance.now();
+  };
+  epoch = performance.timeOrigin;
+} else {
+  now = function() {
+    var time = process.hrtime();
+    return time[0] * 1000 + time[1] / 1000000;
+  };
+  epoch = Date.now() - now();
+}
+
+// Timers handed back by release() are reused, up to this many
+var MAX_POOL_SIZE = 1024;
+var pool = [];
+
 function Timer() {
-  this.startTime = process.hrtime();
-  this.startTimeMillis = Date.now();
+  this.init();
+}
+
+Timer.prototype.init = function() {
+  this.startTime = now();
+  this.startTimeMillis = Math.floor(epoch + this.startTime);
   this.timeDelta = -1;
   this.cpuTimeDelta = -1;
-}
+};
 
 Timer.prototype.stop = function() {
   // Prevent the timer being stopped twice.
   if (this.timeDelta == -1) {
-    var dur = process.hrtime(this.startTime);
-    this.timeDelta = dur[0] * 1000 + dur[1] / 1000000;
+    this.timeDelta = now() - this.startTime;
   }
 };
 
 exports.start = function() {
+  if (pool.length > 0) {
+    var timer = pool.pop();
+    timer.init();
+    return timer;
+  }
   return new Timer();
 };
+
+// Returns a timer that is no longer referenced to the pool
+exports.release = function(timer) {
+  if (pool.length < MAX_POOL_SIZE) pool.push(timer);
+};
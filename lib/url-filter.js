@@ -0,0 +1,278 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+'use strict';
+
+/*
+ * Maps the method and url of an incoming http request to the route it is
+ * reported under.
+ *
+ * The url's query and fragment are dropped, then the configured filters are
+ * tried against 'METHOD /path' in order and the first to match gives the
+ * route, where a route of '' means the request is ignored. Otherwise numeric
+ * and UUID path segments are replaced by ':id' and ':uuid' to keep the number
+ * of routes down.
+ *
+ * Filters anchored with a literal prefix, eg. '^GET /api/users/', are kept
+ * in a trie so only those whose prefix the request has are tried. The filters
+ * that can match at each node of the trie are compiled lazily into one
+ * combined regex, with each filter's pattern in a lookahead so the first
+ * filter in the list that matches anywhere wins, as when testing them one by
+ * one. Filters that can't be combined, because they have flags or
+ * backreferences, are tested on their own in the same order.
+ *
+ * Recent results are kept in a least recently used cache.
+ */
+
+var DEFAULT_CACHE_SIZE = 1000;
+
+var ID_SEGMENTS = /\/(?:(\d+)|[0-9a-fA-F]{8}-[0-9a-fA-F]{4}-[0-9a-fA-F]{4}-[0-9a-fA-F]{4}-[0-9a-fA-F]{12})(?=\/|$)/g;
+
+function collapseSegment(segment, digits) {
+  return digits === undefined ? '/:uuid' : '/:id';
+}
+
+function stripQuery(url) {
+  for (var i = 0; i < url.length; i++) {
+    var c = url.charCodeAt(i);
+    // '?' or '#'
+    if (c === 63 || c === 35) return url.substring(0, i);
+  }
+  return url;
+}
+
+/*
+ * The literal text a pattern must start with, or '' if it isn't anchored
+ * to the start or has a top-level alternative
+ */
+function literalPrefix(source) {
+  if (source.charAt(0) !== '^') return '';
+  // Any top-level '|' means the pattern isn't only anchored by its prefix
+  var depth = 0;
+  var inClass = false;
+  for (var i = 1; i < source.length; i++) {
+    var c = source.charAt(i);
+    if (c === '\\') {
+      i++;
+    } else if (inClass) {
+      if (c === ']') inClass = false;
+    } else if (c === '[') {
+      inClass = true;
+    } else if (c === '(') {
+      depth++;
+    } else if (c === ')') {
+      depth--;
+    } else if (c === '|' && depth === 0) {
+      return '';
+    }
+  }
+
+  var prefix = '';
+  for (var j = 1; j < source.length; j++) {
+    var ch = source.charAt(j);
+    var literal;
+    if (ch === '\\') {
+      var escaped = source.charAt(j + 1);
+      // Escapes of letters and digits are classes or references, not literals
+      if (escaped === '' || /[0-9A-Za-z]/.test(escaped)) break;
+      literal = escaped;
+      j++;
+    } else if ('^$.|?*+()[]{}'.indexOf(ch) !== -1) {
+      break;
+    } else {
+      literal = ch;
+    }
+    // A quantifier that allows zero repeats makes the literal optional
+    var next = source.charAt(j + 1);
+    if (next === '?' || next === '*' || next === '{') break;
+    prefix += literal;
+    if (next === '+') break;
+  }
+  return prefix;
+}
+
+function combinable(regex) {
+  return regex.flags === '' && !/\\[1-9]|\\k</.test(regex.source);
+}
+
+function groupCount(source) {
+  return new RegExp(source + '|').exec('').length - 1;
+}
+
+/*
+ * Builds the steps that try the given filters in order: runs of combinable
+ * filters become one regex, the rest are tested one at a time
+ */
+function compile(filters) {
+  var steps = [];
+  var run = [];
+
+  function endRun() {
+    if (run.length === 0) return;
+    if (run.length === 1) {
+      steps.push({ regex: run[0].regex, markers: null, filters: run });
+    } else {
+      var alternatives = [];
+      var markers = [];
+      var group = 0;
+      for (var i = 0; i < run.length; i++) {
+        var source = run[i].regex.source;
+        alternatives.push('(?=[\\s\\S]*?(?:' + source + '))()');
+        group += groupCount(source) + 1;
+        markers.push(group);
+      }
+      var combined;
+      try {
+        combined = new RegExp('^(?:' + alternatives.join('|') + ')');
+      } catch (e) {
+        // eg. the same group name in two patterns
+        combined = null;
+      }
+      if (combined === null) {
+        for (var j = 0; j < run.length; j++) {
+          steps.push({ regex: run[j].regex, markers: null, filters: [run[j]] });
+        }
+      } else {
+        steps.push({ regex: combined, markers: markers, filters: run });
+      }
+    }
+    run = [];
+  }
+
+  for (var i = 0; i < filters.length; i++) {
+    if (combinable(filters[i].regex)) {
+      run.push(filters[i]);
+    } else {
+      endRun();
+      run.push(filters[i]);
+      endRun();
+    }
+  }
+  endRun();
+  return steps;
+}
+
+function match(steps, identifier) {
+  for (var i = 0; i < steps.length; i++) {
+    var step = steps[i];
+    if (step.markers === null) {
+      if (step.regex.test(identifier)) return step.filters[0];
+      continue;
+    }
+    var result = step.regex.exec(identifier);
+    if (result === null) continue;
+    for (var j = 0; j < step.markers.length; j++) {
+      if (result[step.markers[j]] !== undefined) return step.filters[j];
+    }
+  }
+  return null;
+}
+
+function TrieNode() {
+  this.children = new Map();
+  // Filters whose prefix ends here, and all those that can match from here
+  this.filters = [];
+  this.candidates = null;
+  this.steps = null;
+}
+
+function byIndex(a, b) {
+  return a.index - b.index;
+}
+
+function UrlFilter(filters, options) {
+  options = options || {};
+  this.collapseIds = options.collapseIds !== false;
+  this.cacheSize = typeof options.cacheSize === 'number' ? options.cacheSize : DEFAULT_CACHE_SIZE;
+  this.cache = new Map();
+  this.root = new TrieNode();
+  this.empty = true;
+
+  filters = filters || [];
+  for (var i = 0; i < filters.length; i++) {
+    var filter = filters[i];
+    var regex = filter.regex || new RegExp(filter.pattern);
+    this.add({ index: i, regex: regex, to: filter.to }, regex.flags === '' ? literalPrefix(regex.source) : '');
+  }
+  this.root.candidates = this.root.filters;
+  setCandidates(this.root);
+}
+
+UrlFilter.prototype.add = function(filter, prefix) {
+  var node = this.root;
+  for (var i = 0; i < prefix.length; i++) {
+    var child = node.children.get(prefix.charAt(i));
+    if (child === undefined) {
+      child = new TrieNode();
+      node.children.set(prefix.charAt(i), child);
+    }
+    node = child;
+  }
+  node.filters.push(filter);
+  this.empty = false;
+};
+
+function setCandidates(node) {
+  node.children.forEach(function(child) {
+    child.candidates = child.filters.length === 0 ? node.candidates : node.candidates.concat(child.filters).sort(byIndex);
+    setCandidates(child);
+  });
+}
+
+UrlFilter.prototype.findFilter = function(identifier) {
+  // The deepest node on the identifier's path holds all the filters that can match
+  var node = this.root;
+  var deepest = this.root;
+  for (var i = 0; i < identifier.length; i++) {
+    node = node.children.get(identifier.charAt(i));
+    if (node === undefined) break;
+    if (node.filters.length > 0) deepest = node;
+  }
+  if (deepest.steps === null) deepest.steps = compile(deepest.candidates);
+  return match(deepest.steps, identifier);
+};
+
+UrlFilter.prototype.route = function(method, url) {
+  var path = stripQuery(url);
+  if (this.empty && !this.collapseIds) return path;
+
+  var identifier = method + ' ' + path;
+  var route = this.cache.get(identifier);
+  if (route !== undefined) {
+    // Move to the most recently used end
+    this.cache.delete(identifier);
+    this.cache.set(identifier, route);
+    return route;
+  }
+
+  var filter = this.empty ? null : this.findFilter(identifier);
+  if (filter !== null) {
+    route = filter.to;
+  } else if (this.collapseIds) {
+    route = path.replace(ID_SEGMENTS, collapseSegment);
+  } else {
+    route = path;
+  }
+
+  if (this.cacheSize > 0) {
+    if (this.cache.size >= this.cacheSize) {
+      this.cache.delete(this.cache.keys().next().value);
+    }
+    this.cache.set(identifier, route);
+  }
+  return route;
+};
+
+module.exports = UrlFilter;
@@ -17,14 +17,29 @@
 var Probe = require('../lib/probe.js');
 var aspect = require('../lib/aspect.js');
 var request = require('../lib/request.js');
+var httpSummary = require('../lib/http-summary.js');
+var serverChannels = require('../lib/http-server-channels.js');
+var UrlFilter = require('../lib/url-filter.js');
 var util = require('util');
 var am = require('../');
 
+// The events of requests that end in the same turn of the event loop, which
+// are passed to the agent together
+var pendingEvents = [];
+
+function emitPendingEvents() {
+  var events = pendingEvents;
+  pendingEvents = [];
+  am.emitMany('http', events);
+}
+
 function HttpProbe() {
   Probe.call(this, 'http');
   this.config = {
     filters: [],
+    collapseIds: true,
   };
+  this.urlFilter = new UrlFilter(this.config.filters, this.config);
 }
 util.inherits(HttpProbe, Probe);
 
@@ -33,6 +48,8 @@ HttpProbe.prototype.attach = function(name, target) {
   if (name === 'http') {
     if (target.__probeAttached__) return target;
     target.__probeAttached__ = true;
+    // Requests are seen through diagnostics_channel where Node publishes them
+    if (serverChannels.supported) return target;
     var methods = ['on', 'addListener'];
 
     aspect.before(target.Server.prototype, methods, function(obj, methodName, args, probeData) {
@@ -40,18 +57,14 @@ HttpProbe.prototype.attach = function(name, target) {
       if (obj.__httpProbe__) return;
       obj.__httpProbe__ = true;
       aspect.aroundCallback(args, probeData, function(obj, args, probeData) {
+        // Listeners added while the probe was active stay wrapped
+        if (!that.active) return;
         var httpReq = args[0];
         var res = args[1];
-        // Filter out urls where filter.to is ''
-        var traceUrl = that.filterUrl(httpReq);
-        if (traceUrl !== '') {
-          // Issue #590 - need to keep the probedata context separate from other requests
-          var context = {};
-          that.metricsProbeStart(context, httpReq.method, traceUrl);
-          that.requestProbeStart(context, httpReq.method, traceUrl);
+        var context = that.serverRequestStart(httpReq);
+        if (context !== undefined) {
           aspect.after(res, 'end', context, function(obj, methodName, args, probeData, ret) {
-            that.metricsProbeEnd(probeData, httpReq.method, traceUrl, res, httpReq);
-            that.requestProbeEnd(probeData, httpReq.method, traceUrl, res, httpReq);
+            that.serverRequestEnd(probeData, httpReq, res);
           });
         }
       });
@@ -61,32 +74,38 @@ HttpProbe.prototype.attach = function(name, target) {
 };
 
 /*
- * Custom req.url parser that strips out any trailing query
+ * Start timing an incoming request, returning its context or undefined if
+ * the request's url is filtered out
  */
-function parse(url) {
-  ['?', '#'].forEach(function(separator) {
-    var index = url.indexOf(separator);
-    if (index !== -1) url = url.substring(0, index);
-  });
-  return url;
+HttpProbe.prototype.serverRequestStart = function(httpReq) {
+  // Filter out urls where filter.to is ''
+  var traceUrl = this.filterUrl(httpReq);
+  if (traceUrl === '') return undefined;
+  // Issue #590 - need to keep the probedata context separate from other requests
+  var context = { url: traceUrl };
+  this.metricsProbeStart(context, httpReq.method, traceUrl);
+  this.requestProbeStart(context, httpReq.method, traceUrl);
+  return context;
+};
+
+HttpProbe.prototype.serverRequestEnd = function(context, httpReq, res) {
+  this.metricsProbeEnd(context, httpReq.method, context.url, res, httpReq);
+  this.requestProbeEnd(context, httpReq.method, context.url, res, httpReq);
 };
 
 /*
- * Ignore requests for URLs which we've been configured via regex to ignore
+ * Subscribe to the server channels only while the probe is active
+ */
+HttpProbe.prototype.updatePatches = function() {
+  Probe.prototype.updatePatches.call(this);
+  serverChannels.setProbe('http', this.active ? this : null);
+};
+
+/*
+ * Map the request to the url it is reported under, or '' to ignore it
  */
 HttpProbe.prototype.filterUrl = function(req) {
-  var resultUrl = parse(req.url);
-  var filters = this.config.filters;
-  if (filters.length === 0) return resultUrl;
-
-  var identifier = req.method + ' ' + resultUrl;
-  for (var i = 0; i < filters.length; ++i) {
-    var filter = filters[i];
-    if (filter.regex.test(identifier)) {
-      return filter.to;
-    }
-  }
-  return resultUrl;
+  return this.urlFilter.route(req.method, req.url);
 };
 
 /*
@@ -97,12 +116,19 @@ HttpProbe.prototype.filterUrl = function(req) {
  * 		method:		HTTP method, eg. GET, POST, etc
  * 		url:		The url requested
  * 		duration:	the time for the request to respond
+ *
+ * When http-summary is enabled the request is only recorded in the native
+ * per-route summaries, unless per-request events were asked for as well.
  */
 
 HttpProbe.prototype.metricsEnd = function(probeData, method, url, res, httpReq) {
   if (probeData && probeData.timer) {
     probeData.timer.stop();
-    am.emit('http', {
+    if (httpSummary.enabled) {
+      httpSummary.record(method, url, probeData.timer.timeDelta, res.statusCode, false);
+      if (!httpSummary.events) return;
+    }
+    var length = pendingEvents.push({
       time: probeData.timer.startTimeMillis,
       method: method,
       url: url,
@@ -112,6 +138,7 @@ HttpProbe.prototype.metricsEnd = function(probeData, method, url, res, httpReq)
       contentType: res.getHeader('content-type'),
       requestHeader: httpReq.headers,
     });
+    if (length === 1) setImmediate(emitPendingEvents);
   }
 };
 
@@ -154,6 +181,7 @@ HttpProbe.prototype.setConfig = function(newConfig) {
       this.config[prop] = newConfig[prop];
     }
   }
+  this.urlFilter = new UrlFilter(this.config.filters, this.config);
 };
 
 module.exports = HttpProbe;
@@ -19,6 +19,9 @@ var am = require('../');
 var aspect = require('../lib/aspect.js');
 var Probe = require('../lib/probe.js');
 var request = require('../lib/request.js');
+var httpSummary = require('../lib/http-summary.js');
+var serverChannels = require('../lib/http-server-channels.js');
+var UrlFilter = require('../lib/url-filter.js');
 
 var util = require('util');
 
@@ -26,7 +29,9 @@ function HttpsProbe() {
   Probe.call(this, 'https');
   this.config = {
     filters: [],
+    collapseIds: true,
   };
+  this.urlFilter = new UrlFilter(this.config.filters, this.config);
 }
 util.inherits(HttpsProbe, Probe);
 
@@ -35,6 +40,8 @@ HttpsProbe.prototype.attach = function(name, target) {
   if (name === 'https') {
     if (target.__probeAttached__) return target;
     target.__probeAttached__ = true;
+    // Requests are seen through diagnostics_channel where Node publishes them
+    if (serverChannels.supported) return target;
     var methods = ['on', 'addListener'];
 
     aspect.before(target.Server.prototype, methods, function(obj, methodName, args, probeData) {
@@ -42,18 +49,14 @@ HttpsProbe.prototype.attach = function(name, target) {
       if (obj.__httpsProbe__) return;
       obj.__httpsProbe__ = true;
       aspect.aroundCallback(args, probeData, function(obj, args, probeData) {
+        // Listeners added while the probe was active stay wrapped
+        if (!that.active) return;
         var httpsReq = args[0];
         var res = args[1];
-        // Filter out urls where filter.to is ''
-        var traceUrl = that.filterUrl(httpsReq);
-        if (traceUrl !== '') {
-          // Issue #590 - need to keep the probedata context separate from other requests
-          var context = {};
-          that.metricsProbeStart(context, httpsReq.method, traceUrl);
-          that.requestProbeStart(context, httpsReq.method, traceUrl);
+        var context = that.serverRequestStart(httpsReq);
+        if (context !== undefined) {
           aspect.after(res, 'end', context, function(obj, methodName, args, probeData, ret) {
-            that.metricsProbeEnd(probeData, httpsReq.method, traceUrl, res, httpsReq);
-            that.requestProbeEnd(probeData, httpsReq.method, traceUrl, res, httpsReq);
+            that.serverRequestEnd(probeData, httpsReq, res);
           });
         }
       });
@@ -63,32 +66,38 @@ HttpsProbe.prototype.attach = function(name, target) {
 };
 
 /*
- * Custom req.url parser that strips out any trailing query
+ * Start timing an incoming request, returning its context or undefined if
+ * the request's url is filtered out
  */
-function parse(url) {
-  ['?', '#'].forEach(function(separator) {
-    var index = url.indexOf(separator);
-    if (index !== -1) url = url.substring(0, index);
-  });
-  return url;
+HttpsProbe.prototype.serverRequestStart = function(httpsReq) {
+  // Filter out urls where filter.to is ''
+  var traceUrl = this.filterUrl(httpsReq);
+  if (traceUrl === '') return undefined;
+  // Issue #590 - need to keep the probedata context separate from other requests
+  var context = { url: traceUrl };
+  this.metricsProbeStart(context, httpsReq.method, traceUrl);
+  this.requestProbeStart(context, httpsReq.method, traceUrl);
+  return context;
+};
+
+HttpsProbe.prototype.serverRequestEnd = function(context, httpsReq, res) {
+  this.metricsProbeEnd(context, httpsReq.method, context.url, res, httpsReq);
+  this.requestProbeEnd(context, httpsReq.method, context.url, res, httpsReq);
+};
+
+/*
+ * Subscribe to the server channels only while the probe is active
+ */
+HttpsProbe.prototype.updatePatches = function() {
+  Probe.prototype.updatePatches.call(this);
+  serverChannels.setProbe('https', this.active ? this : null);
 };
 
 /*
- * Ignore requests for URLs which we've been configured via regex to ignore
+ * Map the request to the url it is reported under, or '' to ignore it
  */
 HttpsProbe.prototype.filterUrl = function(req) {
-  var resultUrl = parse(req.url);
-  var filters = this.config.filters;
-  if (filters.length === 0) return resultUrl;
-
-  var identifier = req.method + ' ' + resultUrl;
-  for (var i = 0; i < filters.length; ++i) {
-    var filter = filters[i];
-    if (filter.regex.test(identifier)) {
-      return filter.to;
-    }
-  }
-  return resultUrl;
+  return this.urlFilter.route(req.method, req.url);
 };
 
 /*
@@ -99,11 +108,18 @@ HttpsProbe.prototype.filterUrl = function(req) {
  * 		method:		HTTPS method, eg. GET, POST, etc
  * 		url:		The url requested
  * 		duration:	the time for the request to respond
+ *
+ * When http-summary is enabled the request is only recorded in the native
+ * per-route summaries, unless per-request events were asked for as well.
  */
 
 HttpsProbe.prototype.metricsEnd = function(probeData, method, url, res, httpsReq) {
   if (probeData && probeData.timer) {
     probeData.timer.stop();
+    if (httpSummary.enabled) {
+      httpSummary.record(method, url, probeData.timer.timeDelta, res.statusCode, true);
+      if (!httpSummary.events) return;
+    }
     am.emit('https', {
       time: probeData.timer.startTimeMillis,
       method: method,
@@ -156,6 +172,7 @@ HttpsProbe.prototype.setConfig = function(newConfig) {
       this.config[prop] = newConfig[prop];
     }
   }
+  this.urlFilter = new UrlFilter(this.config.filters, this.config);
 };
 
 module.exports = HttpsProbe;
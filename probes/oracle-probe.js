@@ -112,8 +112,10 @@ OracleProbe.prototype.requestStart = function(probeData, method, methodArgs) {
 };
 
 OracleProbe.prototype.requestEnd = function(probeData, method, methodArgs) {
-  if (probeData && probeData.req) var query = methodArgs[0];
-  probeData.req.stop({ query: query });
+  if (probeData && probeData.req) {
+    var query = methodArgs[0];
+    probeData.req.stop({ query: query });
+  }
 };
 
 module.exports = OracleProbe;
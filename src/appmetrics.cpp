@@ -26,6 +26,11 @@
 #if !defined(_ZOS)
 #include "headlessutils.h"
 #endif
+// Portable, and built on every platform by binding.gyp
+#include "recorder.h"
+#include "history.h"
+#include "rollup.h"
+#include "httpsummary.h"
 
 #if NODE_VERSION_AT_LEAST(0, 11, 0) // > v0.11+
 #include "objecttracker.hpp"
@@ -37,6 +42,7 @@
 #include <fstream>
 #include <sstream>
 #include <cstdlib>
+#include <climits>
 
 #if defined(_WINDOWS)
 #include <windows.h>
@@ -73,6 +79,7 @@ struct Listener {
 };
 
 Listener* listener;
+static bool listenerRegistered = false;
 
 #define PROPERTIES_FILE "appmetrics.properties"
 #define APPMETRICS_VERSION "99.99.99.29991231"
@@ -362,6 +369,10 @@ NAN_METHOD(stop) {
     running = false;
     loaderApi->stop();
     loaderApi->shutdown();
+    recorder::stop();
+    history::stop();
+    rollup::stop();
+    httpsummary::stop();
 #if !defined(_ZOS)
 	  headless::stop();
 #endif
@@ -417,7 +428,7 @@ static void emitMessage(uv_async_t *handle, int status) {
         Local<Value> argv[argc];
         const char * source = (*currentMessage->source).c_str();
 
-        Local<Object> buffer = Nan::CopyBuffer(std::string((char*)currentMessage->data).c_str(), currentMessage->size).ToLocalChecked();
+        Local<Object> buffer = Nan::CopyBuffer((char*)currentMessage->data, currentMessage->size).ToLocalChecked();
         argv[0] = Nan::New<String>(source).ToLocalChecked();
         argv[1] = buffer;
 
@@ -432,12 +443,29 @@ static void emitMessage(uv_async_t *handle, int status) {
 
 }
 
+static void queueMessage(const char* sourceId, const char* data, unsigned int size);
+
 //static void sendData(const std::string &sourceId, unsigned int size, void *data) {
 static void sendData(const char* sourceId, unsigned int size, void *data) {
     if( size == 0 ) {
         return;
     }
 
+    recorder::record(sourceId, (const char*)data, size);
+    history::record(sourceId, (const char*)data, size);
+    rollup::record(sourceId, (const char*)data, size);
+    if( rollup::suppressRaw(sourceId) ) {
+        return;
+    }
+    queueMessage(sourceId, (const char*)data, size);
+}
+
+// Queues data for the JS listener, from any thread
+static void queueMessage(const char* sourceId, const char* data, unsigned int size) {
+    if( NULL == listener ) {
+        return;
+    }
+
     MessageData* payload = new MessageData();
     if( NULL == payload ) {
         return;
@@ -472,40 +500,116 @@ static void sendData(const char* sourceId, unsigned int size, void *data) {
     uv_async_send(messageAsync);
 }
 
+/*
+ * The "topic:data\n" lines pushed by nativeEmit are built in a buffer that
+ * is reused, one per thread so Worker threads don't share it. A buffer that
+ * grew past EMIT_BUFFER_LIMIT for a large burst is freed once it has been
+ * pushed rather than kept at that size.
+ */
+#define EMIT_BUFFER_LIMIT (64 * 1024)
+static uv_once_t emitBufferOnce = UV_ONCE_INIT;
+static uv_key_t emitBufferKey;
+
+static void createEmitBufferKey() {
+    uv_key_create(&emitBufferKey);
+}
+
+static std::string* getEmitBuffer() {
+    uv_once(&emitBufferOnce, createEmitBufferKey);
+    std::string* buffer = static_cast<std::string*>(uv_key_get(&emitBufferKey));
+    if (buffer == NULL) {
+        buffer = new std::string();
+        uv_key_set(&emitBufferKey, buffer);
+    }
+    buffer->clear();
+    return buffer;
+}
+
+static void pushEmitBuffer(std::string* buffer) {
+    monitorApi::pushData(buffer->c_str());
+    if (buffer->capacity() > EMIT_BUFFER_LIMIT) {
+        std::string().swap(*buffer);
+    }
+}
+
+/*
+ * Appends a string as UTF-8 without an intermediate copy. Returns false for
+ * any other type.
+ */
+static bool appendEmitData(std::string& line, Local<Value> value) {
+    if (!value->IsString()) return false;
+    ssize_t length = Nan::DecodeBytes(value, Nan::UTF8);
+    if (length < 0) return false;
+    size_t offset = line.size();
+    line.resize(offset + length);
+    if (length > 0) {
+        Nan::DecodeWrite(&line[offset], length, value, Nan::UTF8);
+    }
+    return true;
+}
+
+/*
+ * nativeEmit(topic, data) pushes the string data to the agent as an api
+ * event. It is sent as a C string so must not contain NUL bytes.
+ */
 NAN_METHOD(nativeEmit) {
 
     if (!isMonitorApiValid()) {
-        Nan::ThrowError("Monitoring API is not initialized");
-        //NanReturnUndefined();
+        return Nan::ThrowError("Monitoring API is not initialized");
     }
 
-    std::stringstream contentss;
-    if (info[0]->IsString()) {
-        Nan::Utf8String str(info[0]);
-        char *c_arg = *str;
-        contentss << c_arg << ":";
-    } else {
+    if (!info[0]->IsString()) {
         /*
          *  Error handling as we don't have a valid parameter
          */
         return Nan::ThrowError("First argument must a event name string");
     }
-    if (info[1]->IsString()) {
-        Nan::Utf8String str(info[1]);
-        char *c_arg = *str;
-        contentss << c_arg;
-
-    } else {
+    std::string* line = getEmitBuffer();
+    appendEmitData(*line, info[0]);
+    line->push_back(':');
+    if (!appendEmitData(*line, info[1])) {
         /*
          *  Error handling as we don't have a valid parameter
          */
-        Nan::ThrowError("Second argument must be a JSON string or a comma separated list of key value pairs");
-        return;
+        return Nan::ThrowError("Second argument must be a JSON string or a comma separated list of key value pairs");
     }
-    contentss << '\n';
-    std::string content = contentss.str();
+    line->push_back('\n');
 
-    monitorApi::pushData(content.c_str());
+    pushEmitBuffer(line);
+
+}
+
+/*
+ * nativeEmitMany(topic, array) is nativeEmit for each item of array, pushed
+ * to the agent together for probes that emit bursts of events.
+ */
+NAN_METHOD(nativeEmitMany) {
+
+    if (!isMonitorApiValid()) {
+        return Nan::ThrowError("Monitoring API is not initialized");
+    }
+
+    if (!info[0]->IsString()) {
+        return Nan::ThrowError("First argument must a event name string");
+    }
+    if (!info[1]->IsArray()) {
+        return Nan::ThrowError("Second argument must be an array of strings");
+    }
+    Local<Array> items = info[1].As<Array>();
+    uint32_t count = items->Length();
+    if (count == 0) return;
+
+    std::string* lines = getEmitBuffer();
+    for (uint32_t i = 0; i < count; i++) {
+        appendEmitData(*lines, info[0]);
+        lines->push_back(':');
+        if (!appendEmitData(*lines, Nan::Get(items, i).ToLocalChecked())) {
+            return Nan::ThrowError("Second argument must be an array of strings");
+        }
+        lines->push_back('\n');
+    }
+
+    pushEmitBuffer(lines);
 
 }
 
@@ -531,6 +635,130 @@ NAN_METHOD(sendControlCommand) {
 
 }
 
+// The recorder and history see data whether or not there is a JS listener
+static void registerDataListener() {
+    if (!listenerRegistered) {
+        listenerRegistered = true;
+        monitorApi::registerListener(sendData);
+    }
+}
+
+NAN_METHOD(startRecording) {
+    if (!isMonitorApiValid()) {
+        return Nan::ThrowError("Monitoring API is not initialized");
+    }
+    if (!info[0]->IsString()) {
+        return Nan::ThrowError("First argument must be the recording file name");
+    }
+    Nan::Utf8String fileArg(info[0]);
+    std::string error;
+    if (!recorder::start(std::string(*fileArg), error)) {
+        return Nan::ThrowError(error.c_str());
+    }
+    registerDataListener();
+}
+
+NAN_METHOD(stopRecording) {
+    recorder::stop();
+}
+
+NAN_METHOD(isRecording) {
+    info.GetReturnValue().Set(recorder::isRecording());
+}
+
+/*
+ * setRollups(enabled, raw) turns the 1s/10s/1m rollups on or off, and
+ * whether the raw gc and loop data they summarize is still delivered.
+ */
+NAN_METHOD(setRollups) {
+    if (!isMonitorApiValid()) {
+        return Nan::ThrowError("Monitoring API is not initialized");
+    }
+    if (Nan::To<bool>(info[0]).FromJust()) {
+        rollup::start(queueMessage);
+        registerDataListener();
+    } else {
+        rollup::stop();
+    }
+    rollup::setRawEvents(info[1]->IsUndefined() || Nan::To<bool>(info[1]).FromJust());
+}
+
+/*
+ * setHttpSummary(enabled, interval, events) turns the per-route http summaries
+ * on or off, emitting them every interval ms. events is whether the probes
+ * still emit an event per request.
+ */
+NAN_METHOD(setHttpSummary) {
+    if (Nan::To<bool>(info[0]).FromJust()) {
+        unsigned int interval = info[1]->IsNumber() ? Nan::To<uint32_t>(info[1]).FromJust() : 0;
+        if (interval == 0) {
+            return Nan::ThrowError("Second argument must be the summary interval in milliseconds");
+        }
+        httpsummary::start(queueMessage, interval, Nan::To<bool>(info[2]).FromJust());
+    } else {
+        httpsummary::stop();
+    }
+}
+
+// httpRoute(method, url) returns the id to pass to httpRecord for the route
+NAN_METHOD(httpRoute) {
+    if (!info[0]->IsString() || !info[1]->IsString()) {
+        return Nan::ThrowError("Arguments must be the request method and url");
+    }
+    Nan::Utf8String methodArg(info[0]);
+    Nan::Utf8String urlArg(info[1]);
+    info.GetReturnValue().Set(httpsummary::route(std::string(*methodArg), std::string(*urlArg)));
+}
+
+// httpRecord(id, duration, statusCode, secure), called for every request so kept minimal
+NAN_METHOD(httpRecord) {
+    httpsummary::record(Nan::To<int32_t>(info[0]).FromJust(), Nan::To<double>(info[1]).FromJust(),
+        Nan::To<int32_t>(info[2]).FromJust(), !Nan::To<bool>(info[3]).FromJust());
+}
+
+NAN_METHOD(startHistory) {
+    if (!isMonitorApiValid()) {
+        return Nan::ThrowError("Monitoring API is not initialized");
+    }
+    if (!info[0]->IsString() || !info[1]->IsString() || !info[2]->IsNumber()) {
+        return Nan::ThrowError("Arguments must be the history directory, file name prefix and ring size");
+    }
+    Nan::Utf8String dirArg(info[0]);
+    Nan::Utf8String nameArg(info[1]);
+    double capacity = Nan::To<double>(info[2]).FromJust();
+    int opened = history::start(std::string(*dirArg), std::string(*nameArg), (unsigned long long) capacity);
+    if (opened > 0) {
+        registerDataListener();
+    }
+    info.GetReturnValue().Set(opened);
+}
+
+/*
+ * readHistory(ring, from, to) returns [{time, topic, data}] for the records
+ * written to ring between from and to, or undefined if it isn't open.
+ */
+NAN_METHOD(readHistory) {
+    if (!info[0]->IsString()) {
+        return Nan::ThrowError("First argument must be a history ring name");
+    }
+    Nan::Utf8String ringArg(info[0]);
+    long long from = info[1]->IsNumber() ? (long long) Nan::To<double>(info[1]).FromJust() : 0;
+    long long to = info[2]->IsNumber() ? (long long) Nan::To<double>(info[2]).FromJust() : LLONG_MAX;
+    std::vector<history::Record> records;
+    if (!history::read(std::string(*ringArg), from, to, records)) {
+        return;
+    }
+    Local<Array> result = Nan::New<Array>(records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        Local<Object> record = Nan::New<Object>();
+        Nan::Set(record, Nan::New<String>("time").ToLocalChecked(), Nan::New<Number>((double) records[i].time));
+        Nan::Set(record, Nan::New<String>("topic").ToLocalChecked(), Nan::New<String>(records[i].topic).ToLocalChecked());
+        Nan::Set(record, Nan::New<String>("data").ToLocalChecked(), Nan::New<String>(records[i].data).ToLocalChecked());
+        Nan::Set(result, i, record);
+    }
+    info.GetReturnValue().Set(result);
+}
+
 #if !defined(_ZOS)
 NAN_METHOD(setHeadlessZipFunction) {
     if (!info[0]->IsFunction()) {
@@ -555,7 +783,7 @@ NAN_METHOD(localConnect) {
     listener = new Listener();
     listener->callback = callback;
 
-    monitorApi::registerListener(sendData);
+    registerDataListener();
 
     return;
 
@@ -723,15 +951,28 @@ void init(Local<Object> exports, Local<Object> module) {
     Nan::SetMethod(exports, "stop", stop);
     Nan::SetMethod(exports, "localConnect", localConnect);
     Nan::SetMethod(exports, "nativeEmit", nativeEmit);
+    Nan::SetMethod(exports, "nativeEmitMany", nativeEmitMany);
     Nan::SetMethod(exports, "sendControlCommand", sendControlCommand);
+    Nan::SetMethod(exports, "startRecording", startRecording);
+    Nan::SetMethod(exports, "stopRecording", stopRecording);
+    Nan::SetMethod(exports, "isRecording", isRecording);
+    Nan::SetMethod(exports, "setRollups", setRollups);
+    Nan::SetMethod(exports, "setHttpSummary", setHttpSummary);
+    Nan::SetMethod(exports, "httpRoute", httpRoute);
+    Nan::SetMethod(exports, "httpRecord", httpRecord);
+    Nan::SetMethod(exports, "startHistory", startHistory);
+    Nan::SetMethod(exports, "readHistory", readHistory);
 #if !defined(_ZOS)
     Nan::SetMethod(exports, "setHeadlessZipFunction", setHeadlessZipFunction);
+    Nan::SetMethod(exports, "zipDirectory", headless::zipDirectory);
+    Nan::SetMethod(exports, "zipDirectorySync", headless::zipDirectorySync);
 #endif
 #if defined(_LINUX)
     Nan::SetMethod(exports, "lrtime", lrtime);
 #endif
 #if NODE_VERSION_AT_LEAST(0, 11, 0) // > v0.11+
     Nan::SetMethod(exports, "getObjectHistogram", getObjectHistogram);
+    objecttracker::InitHistogramSession(exports);
 #endif
     /*
      * Initialize healthcenter core library
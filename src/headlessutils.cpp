@@ -16,10 +16,14 @@
 
 
 #include "headlessutils.h"
+#include <cstring>
+#include <ctime>
 #include <iostream>
 #include <string>
+#include <vector>
 #include "nan.h"
 #include "uv.h"
+#include "zlib.h"
 
 namespace headless {
 
@@ -69,6 +73,393 @@ void zip(const char* dir) {
 	uv_async_send(&async_zip);
 }
 
+/*
+ * Streaming zip writer. Each file is read, deflated and written in
+ * ZIP_CHUNK_SIZE pieces so memory use does not depend on the size of the
+ * recording. Sizes and CRCs follow each entry in a data descriptor, which
+ * avoids seeking back over the output. There is no zip64 support, so an
+ * archive that would pass 4GB or 65535 entries fails rather than being
+ * written with truncated offsets.
+ */
+namespace {
+
+const size_t ZIP_CHUNK_SIZE = 64 * 1024;
+const uint64_t ZIP_MAX_OFFSET = 0xffffffffULL;
+const size_t ZIP_MAX_ENTRIES = 0xffff;
+
+// Serializes archiving, so a synchronous zip at exit waits for one running
+// on the threadpool rather than reading the directory it is removing
+uv_once_t zipMutexOnce = UV_ONCE_INIT;
+uv_mutex_t zipMutex;
+
+void initZipMutex() {
+	uv_mutex_init(&zipMutex);
+}
+
+struct ZipEntry {
+	std::string name;
+	uint32_t crc;
+	uint32_t compressedSize;
+	uint32_t size;
+	uint32_t offset;
+};
+
+void put16(std::string& out, uint32_t value) {
+	out.push_back((char) (value & 0xff));
+	out.push_back((char) ((value >> 8) & 0xff));
+}
+
+void put32(std::string& out, uint32_t value) {
+	put16(out, value & 0xffff);
+	put16(out, value >> 16);
+}
+
+class ZipWriter {
+public:
+	ZipWriter() : fd(-1), offset(0), dosTime(0), dosDate(0) {
+		// Archives are written on the threadpool, so use the reentrant forms
+		time_t now = time(NULL);
+		struct tm local;
+#if defined(_WINDOWS)
+		bool converted = localtime_s(&local, &now) == 0;
+#else
+		bool converted = localtime_r(&now, &local) != NULL;
+#endif
+		if (converted) {
+			dosTime = (local.tm_hour << 11) | (local.tm_min << 5) | (local.tm_sec / 2);
+			dosDate = ((local.tm_year - 80) << 9) | ((local.tm_mon + 1) << 5) | local.tm_mday;
+		}
+	}
+
+	~ZipWriter() {
+		closeOutput();
+	}
+
+	bool open(const std::string& path) {
+		uv_fs_t req;
+		fd = uv_fs_open(NULL, &req, path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644, NULL);
+		uv_fs_req_cleanup(&req);
+		if (fd < 0) {
+			return fail("Unable to open " + path, fd);
+		}
+		return true;
+	}
+
+	bool addFile(const std::string& name, const std::string& path) {
+		if (entries.size() >= ZIP_MAX_ENTRIES) {
+			error = "Too many files to archive";
+			return false;
+		}
+		uv_fs_t req;
+		int file = uv_fs_open(NULL, &req, path.c_str(), O_RDONLY, 0, NULL);
+		uv_fs_req_cleanup(&req);
+		if (file < 0) {
+			return fail("Unable to open " + path, file);
+		}
+		bool ok = deflateFile(name, file);
+		uv_fs_close(NULL, &req, file, NULL);
+		uv_fs_req_cleanup(&req);
+		return ok;
+	}
+
+	bool finish() {
+		std::string directory;
+		for (size_t i = 0; i < entries.size(); i++) {
+			const ZipEntry& entry = entries[i];
+			put32(directory, 0x02014b50);
+			put16(directory, 20);      // version made by
+			put16(directory, 20);      // version needed to extract
+			put16(directory, 0x0808);  // data descriptor, UTF-8 names
+			put16(directory, 8);       // deflate
+			put16(directory, dosTime);
+			put16(directory, dosDate);
+			put32(directory, entry.crc);
+			put32(directory, entry.compressedSize);
+			put32(directory, entry.size);
+			put16(directory, entry.name.length());
+			put16(directory, 0);       // extra field length
+			put16(directory, 0);       // comment length
+			put16(directory, 0);       // disk number
+			put16(directory, 0);       // internal attributes
+			put32(directory, 0);       // external attributes
+			put32(directory, entry.offset);
+			directory.append(entry.name);
+		}
+		if (offset + directory.length() > ZIP_MAX_OFFSET) {
+			error = "Archive is too large";
+			return false;
+		}
+		uint32_t directoryOffset = (uint32_t) offset;
+		uint32_t directorySize = directory.length();
+		put32(directory, 0x06054b50);
+		put16(directory, 0);
+		put16(directory, 0);
+		put16(directory, entries.size());
+		put16(directory, entries.size());
+		put32(directory, directorySize);
+		put32(directory, directoryOffset);
+		put16(directory, 0);
+		if (!write(directory.data(), directory.length())) return false;
+		return closeOutput();
+	}
+
+	std::string error;
+
+private:
+	uv_file fd;
+	uint64_t offset;
+	uint32_t dosTime;
+	uint32_t dosDate;
+	std::vector<ZipEntry> entries;
+
+	bool fail(const std::string& message, int err) {
+		error = message + ": " + uv_strerror(err);
+		return false;
+	}
+
+	bool closeOutput() {
+		if (fd < 0) return true;
+		uv_fs_t req;
+		int result = uv_fs_close(NULL, &req, fd, NULL);
+		uv_fs_req_cleanup(&req);
+		fd = -1;
+		return result < 0 ? fail("Unable to close archive", result) : true;
+	}
+
+	bool write(const char *data, size_t length) {
+		while (length > 0) {
+			uv_fs_t req;
+			uv_buf_t buf = uv_buf_init(const_cast<char*>(data), length);
+			int written = uv_fs_write(NULL, &req, fd, &buf, 1, -1, NULL);
+			uv_fs_req_cleanup(&req);
+			if (written < 0) {
+				return fail("Unable to write archive", written);
+			}
+			data += written;
+			length -= written;
+			offset += written;
+		}
+		return true;
+	}
+
+	bool deflateFile(const std::string& name, uv_file file) {
+		ZipEntry entry;
+		entry.name = name;
+		entry.crc = crc32(0L, Z_NULL, 0);
+		entry.compressedSize = 0;
+		entry.size = 0;
+		if (offset > ZIP_MAX_OFFSET) {
+			error = "Archive is too large";
+			return false;
+		}
+		entry.offset = (uint32_t) offset;
+
+		std::string header;
+		put32(header, 0x04034b50);
+		put16(header, 20);
+		put16(header, 0x0808);
+		put16(header, 8);
+		put16(header, dosTime);
+		put16(header, dosDate);
+		put32(header, 0);  // crc and sizes are in the data descriptor
+		put32(header, 0);
+		put32(header, 0);
+		put16(header, name.length());
+		put16(header, 0);
+		header.append(name);
+		if (!write(header.data(), header.length())) return false;
+
+		z_stream stream;
+		memset(&stream, 0, sizeof(stream));
+		if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+			error = "Unable to initialize deflate";
+			return false;
+		}
+		std::vector<char> in(ZIP_CHUNK_SIZE);
+		std::vector<char> out(ZIP_CHUNK_SIZE);
+		uint64_t total = 0;
+		uint64_t compressed = 0;
+		bool ok = true;
+		int flush = Z_NO_FLUSH;
+		while (ok && flush != Z_FINISH) {
+			uv_fs_t req;
+			uv_buf_t buf = uv_buf_init(&in[0], in.size());
+			int bytesRead = uv_fs_read(NULL, &req, file, &buf, 1, -1, NULL);
+			uv_fs_req_cleanup(&req);
+			if (bytesRead < 0) {
+				ok = fail("Unable to read " + name, bytesRead);
+				break;
+			}
+			total += bytesRead;
+			if (total > 0xffffffffULL) {
+				error = name + " is too large to archive";
+				ok = false;
+				break;
+			}
+			entry.crc = crc32(entry.crc, reinterpret_cast<Bytef*>(&in[0]), bytesRead);
+			flush = bytesRead == 0 ? Z_FINISH : Z_NO_FLUSH;
+			stream.next_in = reinterpret_cast<Bytef*>(&in[0]);
+			stream.avail_in = bytesRead;
+			do {
+				stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+				stream.avail_out = out.size();
+				int result = deflate(&stream, flush);
+				// Z_BUF_ERROR only means no progress was possible this time round
+				if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+					error = "Unable to compress " + name;
+					ok = false;
+					break;
+				}
+				if (flush == Z_FINISH && result != Z_STREAM_END && stream.avail_out != 0) {
+					error = "Unable to compress " + name;
+					ok = false;
+					break;
+				}
+				size_t produced = out.size() - stream.avail_out;
+				if (!write(&out[0], produced)) {
+					ok = false;
+					break;
+				}
+				compressed += produced;
+				if (compressed > ZIP_MAX_OFFSET) {
+					error = name + " is too large to archive";
+					ok = false;
+					break;
+				}
+			} while (stream.avail_out == 0);
+		}
+		if (deflateEnd(&stream) != Z_OK && ok) {
+			error = "Unable to compress " + name;
+			ok = false;
+		}
+		if (!ok) return false;
+		entry.compressedSize = (uint32_t) compressed;
+		entry.size = (uint32_t) total;
+
+		std::string descriptor;
+		put32(descriptor, 0x08074b50);
+		put32(descriptor, entry.crc);
+		put32(descriptor, entry.compressedSize);
+		put32(descriptor, entry.size);
+		if (!write(descriptor.data(), descriptor.length())) return false;
+		entries.push_back(entry);
+		return true;
+	}
+};
+
+void removeFile(const std::string& path) {
+	uv_fs_t req;
+	uv_fs_unlink(NULL, &req, path.c_str(), NULL);
+	uv_fs_req_cleanup(&req);
+}
+
+// Returns the names of the regular files in dir, or false if it can't be read
+bool listFiles(const std::string& dir, std::vector<std::string>& files, std::string& error) {
+	uv_fs_t req;
+	int result = uv_fs_scandir(NULL, &req, dir.c_str(), 0, NULL);
+	if (result < 0) {
+		uv_fs_req_cleanup(&req);
+		error = "Unable to read " + dir + ": " + uv_strerror(result);
+		return false;
+	}
+	uv_dirent_t entry;
+	while (uv_fs_scandir_next(&req, &entry) != UV_EOF) {
+		if (entry.type == UV_DIRENT_FILE || entry.type == UV_DIRENT_UNKNOWN) {
+			files.push_back(entry.name);
+		}
+	}
+	uv_fs_req_cleanup(&req);
+	return true;
+}
+
+/*
+ * Writes every file in dir to the archive at output and removes dir once the
+ * archive is complete. On failure the partial archive is removed and dir is
+ * left in place.
+ */
+bool zipDirectoryLocked(const std::string& dir, const std::string& output, std::string& error) {
+	std::vector<std::string> files;
+	if (!listFiles(dir, files, error)) return false;
+
+	ZipWriter writer;
+	bool ok = writer.open(output);
+	for (size_t i = 0; ok && i < files.size(); i++) {
+		ok = writer.addFile(files[i], dir + "/" + files[i]);
+	}
+	if (ok) ok = writer.finish();
+	if (!ok) {
+		error = writer.error;
+		removeFile(output);
+		return false;
+	}
+
+	for (size_t i = 0; i < files.size(); i++) {
+		removeFile(dir + "/" + files[i]);
+	}
+	uv_fs_t req;
+	uv_fs_rmdir(NULL, &req, dir.c_str(), NULL);
+	uv_fs_req_cleanup(&req);
+	return true;
+}
+
+bool zipAndRemove(const std::string& dir, const std::string& output, std::string& error) {
+	uv_once(&zipMutexOnce, initZipMutex);
+	uv_mutex_lock(&zipMutex);
+	bool ok = zipDirectoryLocked(dir, output, error);
+	uv_mutex_unlock(&zipMutex);
+	return ok;
+}
+
+class ZipWorker : public Nan::AsyncWorker {
+public:
+	ZipWorker(Nan::Callback *callback, const std::string& dir, const std::string& output)
+		: Nan::AsyncWorker(callback), dir(dir), output(output) {}
+
+	void Execute() {
+		std::string error;
+		if (!zipAndRemove(dir, output, error)) {
+			SetErrorMessage(error.c_str());
+		}
+	}
+
+private:
+	std::string dir;
+	std::string output;
+};
+
+bool getZipArguments(const Nan::FunctionCallbackInfo<v8::Value>& info, std::string& dir, std::string& output) {
+	if (info.Length() < 2 || !info[0]->IsString() || !info[1]->IsString()) {
+		Nan::ThrowError("Arguments must be the directory to zip and the output file name");
+		return false;
+	}
+	Nan::Utf8String dirArg(info[0]);
+	Nan::Utf8String outputArg(info[1]);
+	dir = std::string(*dirArg);
+	output = std::string(*outputArg);
+	return true;
+}
+
+} /* anonymous namespace */
+
+NAN_METHOD(zipDirectory) {
+	std::string dir, output;
+	if (!getZipArguments(info, dir, output)) return;
+	if (!info[2]->IsFunction()) {
+		return Nan::ThrowError("Third argument must be a callback function");
+	}
+	Nan::Callback *callback = new Nan::Callback(info[2].As<v8::Function>());
+	Nan::AsyncQueueWorker(new ZipWorker(callback, dir, output));
+}
+
+// For use from process 'exit' handlers, where the threadpool can't be used
+NAN_METHOD(zipDirectorySync) {
+	std::string dir, output;
+	if (!getZipArguments(info, dir, output)) return;
+	std::string error;
+	if (!zipAndRemove(dir, output, error)) {
+		return Nan::ThrowError(error.c_str());
+	}
+}
 
 } /* end namespace headless */
 
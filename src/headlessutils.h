@@ -28,5 +28,10 @@ namespace headless {
 	void stop();
 	void zip(const char* dir);
 
+	// Stream every file in a directory into a zip archive, then remove the
+	// directory. The async form runs on the libuv threadpool.
+	NAN_METHOD(zipDirectory);
+	NAN_METHOD(zipDirectorySync);
+
 } /* namespace headless */
 #endif /* HEADLESSUTILS_H_ */
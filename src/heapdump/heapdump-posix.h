@@ -21,6 +21,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
@@ -30,11 +32,17 @@ static char snapshot_filename[kMaxPath];
 static uv_signal_t signal_handle;
 static uv_signal_t sigchld_handle;
 static pid_t child_pid = -1;
+static uint64_t child_start_time;
 static bool nofork;
 
+inline bool SnapshotInProgress() {
+  return uv_is_active(reinterpret_cast<uv_handle_t*>(&sigchld_handle));
+}
+
 inline void OnSIGUSR2(uv_signal_t* handle, int signo) {
   assert(handle == &signal_handle);
   v8::Isolate* isolate = reinterpret_cast<v8::Isolate*>(handle->data);
+  if (SnapshotInProgress()) return;
   on_complete_callback.Reset();
   RandomSnapshotFilename(snapshot_filename, sizeof(snapshot_filename));
   WriteSnapshot(isolate, snapshot_filename);
@@ -45,36 +53,93 @@ inline void OnSIGCHLD(uv_signal_t* handle, int signo) {
   assert(nofork == false);
 
   int status;
-  pid_t pid = waitpid(child_pid, &status, WNOHANG);
+  struct rusage usage;
+  memset(&usage, 0, sizeof(usage));
+  pid_t pid = wait4(child_pid, &status, WNOHANG, &usage);
   if (pid == 0) {
     return;
   }
 
-  InvokeCallback(snapshot_filename);
+  SnapshotStats stats;
+  stats.forked = true;
+  stats.duration_ms = (uv_hrtime() - child_start_time) / 1e6;
+  const char* error = NULL;
 
   // ECHILD is not an error, it means that libuv's internal SIGCHLD handler
   // came before use and consumed the event.  Just ignore it and stop the
-  // signal watcher, our child is gone and that's what matters.
-  if (pid == -1 && errno != ECHILD) {
-    perror("(node-heapdump) waitpid");
-    return;
+  // signal watcher, our child is gone and that's what matters.  We don't
+  // know how it went though, so its status is reported as unknown.
+  if (pid == -1) {
+    if (errno != ECHILD) {
+      perror("(node-heapdump) waitpid");
+      return;
+    }
+  } else {
+    stats.status_known = true;
+#ifdef __APPLE__
+    stats.max_rss = static_cast<double>(usage.ru_maxrss);  // bytes
+#else
+    stats.max_rss = static_cast<double>(usage.ru_maxrss) * 1024;  // KiB
+#endif
+    stats.minor_faults = static_cast<double>(usage.ru_minflt);
+    stats.major_faults = static_cast<double>(usage.ru_majflt);
+    if (WIFSIGNALED(status)) {
+      // Most likely the OOM killer, as the heap was too large to copy.
+      stats.term_signal = WTERMSIG(status);
+      error = "heap snapshot process was killed by a signal";
+    } else if (WIFEXITED(status)) {
+      stats.exit_code = WEXITSTATUS(status);
+      if (stats.exit_code != 0) error = "heap snapshot process failed";
+    }
   }
+
   uv_signal_stop(&sigchld_handle);
+  InvokeCallback(snapshot_filename, error, stats);
+}
+
+// The child shares the parent's pages copy-on-write, so in the worst case
+// (the parent mutating the whole heap while the child serializes it) the
+// heap is duplicated.  Refuse to fork when that would not fit.
+inline bool EnoughMemoryToFork(v8::Isolate* isolate) {
+  v8::HeapStatistics heap;
+  isolate->GetHeapStatistics(&heap);
+  uint64_t available = uv_get_free_memory();
+#if UV_VERSION_HEX >= 0x011D00  // uv_get_constrained_memory() added in 1.29
+  const uint64_t limit = uv_get_constrained_memory();
+  size_t rss = 0;
+  if (limit > 0 && uv_resident_set_memory(&rss) == 0) {
+    const uint64_t headroom = limit > rss ? limit - rss : 0;
+    if (headroom < available) available = headroom;
+  }
+#endif
+  return available >= heap.used_heap_size();
 }
 
 inline bool WriteSnapshot(v8::Isolate* isolate, const char* filename) {
+  SnapshotStats stats;
   if (nofork == true) {
-    WriteSnapshotHelper(isolate, filename);
-    InvokeCallback(filename);
+    const uint64_t start = uv_hrtime();
+    const bool result = WriteSnapshotHelper(isolate, filename);
+    stats.duration_ms = (uv_hrtime() - start) / 1e6;
+    InvokeCallback(filename, result ? NULL : "unable to write heap snapshot",
+                   stats);
     return true;
   }
-  if (uv_is_active(reinterpret_cast<uv_handle_t*>(&sigchld_handle))) {
+  if (SnapshotInProgress()) {
     return false;  // Already busy writing a snapshot.
   }
+  if (!EnoughMemoryToFork(isolate)) {
+    stats.forked = true;
+    InvokeCallback(filename,
+                   "not enough free memory to fork for a heap snapshot",
+                   stats);
+    return false;
+  }
   if (filename != snapshot_filename) {
     // Save copy for when the child process finishes.
     snprintf(snapshot_filename, sizeof(snapshot_filename), "%s", filename);
   }
+  child_start_time = uv_hrtime();
   child_pid = fork();
   if (child_pid == -1) {
     return false;
@@ -84,23 +149,32 @@ inline bool WriteSnapshot(v8::Isolate* isolate, const char* filename) {
     return true;
   }
   setsid();
-  WriteSnapshotHelper(isolate, filename);
-  _exit(42);
+  _exit(WriteSnapshotHelper(isolate, filename) ? 0 : 1);
   return true;  // Placate compiler.
 }
 
+// May be called more than once to change the flags, e.g. when the signal
+// should be handled from JS instead.
 inline void PlatformInit(v8::Isolate* isolate, int flags) {
+  static bool sigchld_initialized = false;
+  static bool signal_initialized = false;
   nofork = !(flags & kForkFlag);
-  if (nofork == false) {
+  if (nofork == false && sigchld_initialized == false) {
     uv_signal_init(uv_default_loop(), &sigchld_handle);
+    sigchld_initialized = true;
   }
   const bool nosignal = !(flags & kSignalFlag);
-  if (nosignal == false) {
+  if (nosignal == true) {
+    if (signal_initialized == true) uv_signal_stop(&signal_handle);
+    return;
+  }
+  if (signal_initialized == false) {
     uv_signal_init(uv_default_loop(), &signal_handle);
-    uv_signal_start(&signal_handle, OnSIGUSR2, SIGUSR2);
-    uv_unref(reinterpret_cast<uv_handle_t*>(&signal_handle));
     signal_handle.data = isolate;
+    signal_initialized = true;
   }
+  uv_signal_start(&signal_handle, OnSIGUSR2, SIGUSR2);
+  uv_unref(reinterpret_cast<uv_handle_t*>(&signal_handle));
 }
 
 }  // namespace anonymous
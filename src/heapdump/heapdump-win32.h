@@ -19,9 +19,16 @@ namespace {
 
 inline void PlatformInit(v8::Isolate*, int) {}
 
+// Snapshots are written synchronously
+inline bool SnapshotInProgress() { return false; }
+
 inline bool WriteSnapshot(v8::Isolate* isolate, const char* filename) {
+  SnapshotStats stats;
+  const uint64_t start = uv_hrtime();
   bool result = WriteSnapshotHelper(isolate, filename);
-  InvokeCallback(filename);
+  stats.duration_ms = (uv_hrtime() - start) / 1e6;
+  InvokeCallback(filename, result ? NULL : "unable to write heap snapshot",
+                 stats);
   return result;
 }
 
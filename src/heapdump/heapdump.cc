@@ -29,10 +29,30 @@ namespace {
 static const int kMaxPath = 4096;
 static const int kForkFlag = 1;
 static const int kSignalFlag = 2;
+
+// Cost of writing a snapshot, passed to the completion callback.  The
+// resource figures and exit status are only known when the snapshot was
+// written by a forked child that was reaped here, and are -1 otherwise.
+struct SnapshotStats {
+  SnapshotStats()
+      : forked(false), status_known(false), duration_ms(0), max_rss(-1),
+        minor_faults(-1), major_faults(-1), exit_code(-1), term_signal(0) {}
+  bool forked;
+  bool status_known;
+  double duration_ms;
+  double max_rss;       // bytes
+  double minor_faults;  // includes copy-on-write faults in the child
+  double major_faults;
+  int exit_code;
+  int term_signal;
+};
+
 inline bool WriteSnapshot(v8::Isolate* isolate, const char* filename);
 inline bool WriteSnapshotHelper(v8::Isolate* isolate, const char* filename);
-inline void InvokeCallback(const char* filename);
+inline void InvokeCallback(const char* filename, const char* error,
+                           const SnapshotStats& stats);
 inline void PlatformInit(v8::Isolate* isolate, int flags);
+inline bool SnapshotInProgress();
 inline void RandomSnapshotFilename(char* buffer, size_t size);
 static ::compat::Persistent<v8::Function> on_complete_callback;
 
@@ -95,9 +115,15 @@ inline C::ReturnType WriteSnapshot(const C::ArgumentType& args) {
     maybe_function = args[1];
   }
 
+  // The callback of the snapshot being written is kept until it completes.
+  if (SnapshotInProgress()) {
+    return handle_scope.Return(false);
+  }
   if (maybe_function->IsFunction()) {
     Local<Function> function = maybe_function.As<Function>();
     on_complete_callback.Reset(isolate, function);
+  } else {
+    on_complete_callback.Reset();
   }
 
   char filename[kMaxPath];
@@ -128,13 +154,44 @@ inline bool WriteSnapshotHelper(Isolate* isolate, const char* filename) {
   return true;
 }
 
-inline void InvokeCallback(const char* filename) {
+inline Local<Object> StatsToObject(const SnapshotStats& stats) {
+  Local<Object> result = Nan::New<Object>();
+  Nan::Set(result, Nan::New("mode").ToLocalChecked(),
+           Nan::New(stats.forked ? "fork" : "inline").ToLocalChecked());
+  Nan::Set(result, Nan::New("duration").ToLocalChecked(),
+           Nan::New<v8::Number>(stats.duration_ms));
+  if (stats.forked && !stats.status_known) {
+    // The child was reaped by someone else, so how it went is unknown
+    Nan::Set(result, Nan::New("exitCode").ToLocalChecked(), Nan::Null());
+    Nan::Set(result, Nan::New("signal").ToLocalChecked(), Nan::Null());
+  } else if (stats.forked) {
+    Nan::Set(result, Nan::New("maxRSS").ToLocalChecked(),
+             Nan::New<v8::Number>(stats.max_rss));
+    Nan::Set(result, Nan::New("minorFaults").ToLocalChecked(),
+             Nan::New<v8::Number>(stats.minor_faults));
+    Nan::Set(result, Nan::New("majorFaults").ToLocalChecked(),
+             Nan::New<v8::Number>(stats.major_faults));
+    Nan::Set(result, Nan::New("exitCode").ToLocalChecked(),
+             Nan::New<v8::Integer>(stats.exit_code));
+    Nan::Set(result, Nan::New("signal").ToLocalChecked(),
+             Nan::New<v8::Integer>(stats.term_signal));
+  }
+  return result;
+}
+
+inline void InvokeCallback(const char* filename, const char* error,
+                           const SnapshotStats& stats) {
   if (on_complete_callback.IsEmpty()) return;
   Isolate* isolate = Isolate::GetCurrent();
   C::HandleScope handle_scope(isolate);
+  // Each callback is for one snapshot
   Local<Function> callback = on_complete_callback.ToLocal(isolate);
-  Local<Value> argv[] = {C::Null(isolate),
-                         C::String::NewFromUtf8(isolate, filename)};
+  on_complete_callback.Reset();
+  Local<Value> err = C::Null(isolate);
+  if (error != NULL) err = Nan::Error(error);
+  Local<Value> argv[] = {err,
+                         C::String::NewFromUtf8(isolate, filename),
+                         StatsToObject(stats)};
   const int argc = sizeof(argv) / sizeof(*argv);
 #if !NODE_VERSION_AT_LEAST(0, 11, 0)
   node::MakeCallback(Context::GetCurrent()->Global(), callback, argc, argv);
@@ -0,0 +1,418 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+
+#include "history.h"
+#include <cstring>
+#include <ctime>
+#include <sstream>
+#include "uv.h"
+#if defined(_WINDOWS)
+#include <windows.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#define HISTORY_MAGIC "AMHR"
+#define HISTORY_VERSION 1
+#define HISTORY_HEADER_SIZE 64
+#define HISTORY_RECORD_HEADER_SIZE 16
+#define HISTORY_MIN_CAPACITY 4096
+
+#if !defined(_WINDOWS) && !defined(O_NOFOLLOW)
+#define O_NOFOLLOW 0
+#endif
+
+namespace history {
+
+namespace {
+
+struct Header {
+	char magic[4];
+	uint32_t version;
+	uint64_t capacity;
+	uint64_t head;
+	uint64_t tail;
+};
+
+struct RecordHeader {
+	uint32_t length;
+	uint8_t topic;
+	uint8_t padding[3];
+	int64_t time;
+};
+
+struct Ring {
+	const char *name;
+	char *base;
+	size_t mappedSize;
+#if defined(_WINDOWS)
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int fd;
+#endif
+};
+
+Ring rings[] = {
+	{ "gc" }, { "loop" }, { "memory" }, { "cpu" }, { "http" }
+};
+const int RING_COUNT = sizeof(rings) / sizeof(rings[0]);
+enum { GC, LOOP, MEMORY, CPU, HTTP };
+
+// Source names as pushed by the plugins, and the ring each is kept in
+struct Topic {
+	const char *name;
+	int ring;
+};
+
+const Topic topics[] = {
+	{ "gc_node", GC },
+	{ "loop_node", LOOP },
+	{ "memory", MEMORY },
+	{ "memory_node", MEMORY },
+	{ "common_memory", MEMORY },
+	{ "cpu", CPU },
+	{ "common_cpu", CPU },
+	{ "api", HTTP }
+};
+const int TOPIC_COUNT = sizeof(topics) / sizeof(topics[0]);
+
+// Guards running and the rings, as record() is called from agent threads
+uv_once_t mutexOnce = UV_ONCE_INIT;
+uv_mutex_t mutex;
+bool running = false;
+
+void initMutex() {
+	uv_mutex_init(&mutex);
+}
+
+int64_t now() {
+#if defined(_WINDOWS)
+	SYSTEMTIME st;
+	GetSystemTime(&st);
+	return ((int64_t) std::time(NULL)) * 1000 + st.wMilliseconds;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return ((int64_t) tv.tv_sec) * 1000 + tv.tv_usec / 1000;
+#endif
+}
+
+uint64_t align(uint64_t size) {
+	return (size + 7) & ~((uint64_t) 7);
+}
+
+Header* header(Ring& ring) {
+	return reinterpret_cast<Header*>(ring.base);
+}
+
+char* data(Ring& ring) {
+	return ring.base + HISTORY_HEADER_SIZE;
+}
+
+// Copies into and out of the ring at a logical offset, wrapping at the end
+void copyIn(Ring& ring, uint64_t position, const void *source, size_t length) {
+	uint64_t capacity = header(ring)->capacity;
+	size_t start = position % capacity;
+	size_t first = length < capacity - start ? length : capacity - start;
+	memcpy(data(ring) + start, source, first);
+	memcpy(data(ring), static_cast<const char*>(source) + first, length - first);
+}
+
+void copyOut(Ring& ring, uint64_t position, void *destination, size_t length) {
+	uint64_t capacity = header(ring)->capacity;
+	size_t start = position % capacity;
+	size_t first = length < capacity - start ? length : capacity - start;
+	memcpy(destination, data(ring) + start, first);
+	memcpy(static_cast<char*>(destination) + first, data(ring), length - first);
+}
+
+// A header that is not ours, or was left inconsistent, is reset
+bool validHeader(Header *h, uint64_t capacity) {
+	return memcmp(h->magic, HISTORY_MAGIC, 4) == 0 && h->version == HISTORY_VERSION
+		&& h->capacity == capacity && h->tail <= h->head && h->head - h->tail <= capacity
+		&& h->head % 8 == 0 && h->tail % 8 == 0;
+}
+
+void unmap(Ring& ring) {
+	if (ring.base == NULL) return;
+#if defined(_WINDOWS)
+	UnmapViewOfFile(ring.base);
+	CloseHandle(ring.mapping);
+	CloseHandle(ring.file);
+#else
+	munmap(ring.base, ring.mappedSize);
+	close(ring.fd);
+#endif
+	ring.base = NULL;
+}
+
+/*
+ * Maps path, which is locked so two processes never share a ring. Returns
+ * false if it can't be opened or is in use.
+ */
+bool map(Ring& ring, const std::string& path, uint64_t capacity) {
+	size_t size = HISTORY_HEADER_SIZE + capacity;
+#if defined(_WINDOWS)
+	// No sharing, so a second process can't open it
+	ring.file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (ring.file == INVALID_HANDLE_VALUE) return false;
+	ring.mapping = CreateFileMappingA(ring.file, NULL, PAGE_READWRITE, 0, (DWORD) size, NULL);
+	if (ring.mapping == NULL) {
+		CloseHandle(ring.file);
+		return false;
+	}
+	ring.base = static_cast<char*>(MapViewOfFile(ring.mapping, FILE_MAP_ALL_ACCESS, 0, 0, size));
+	if (ring.base == NULL) {
+		CloseHandle(ring.mapping);
+		CloseHandle(ring.file);
+		return false;
+	}
+#else
+	// Never follow a link planted in place of a ring, and keep what is
+	// recorded private to this user
+	ring.fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW, 0600);
+	if (ring.fd == -1) return false;
+	struct flock lock;
+	memset(&lock, 0, sizeof(lock));
+	lock.l_type = F_WRLCK;
+	lock.l_whence = SEEK_SET;
+	struct stat st;
+	if (fcntl(ring.fd, F_SETLK, &lock) != 0 || fstat(ring.fd, &st) != 0
+			|| !S_ISREG(st.st_mode) || st.st_nlink != 1 || st.st_uid != geteuid()
+			|| fchmod(ring.fd, 0600) != 0
+			|| ((size_t) st.st_size != size && ftruncate(ring.fd, size) != 0)) {
+		close(ring.fd);
+		return false;
+	}
+	void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, ring.fd, 0);
+	if (base == MAP_FAILED) {
+		close(ring.fd);
+		return false;
+	}
+	ring.base = static_cast<char*>(base);
+#endif
+	ring.mappedSize = size;
+
+	Header *h = header(ring);
+	if (!validHeader(h, capacity)) {
+		memset(h, 0, HISTORY_HEADER_SIZE);
+		memcpy(h->magic, HISTORY_MAGIC, 4);
+		h->version = HISTORY_VERSION;
+		h->capacity = capacity;
+	}
+	return true;
+}
+
+// Returns the end of the JSON string starting at the quote at i
+size_t skipString(const std::string& json, size_t i) {
+	for (i++; i < json.length(); i++) {
+		if (json[i] == '\\') {
+			i++;
+		} else if (json[i] == '"') {
+			return i + 1;
+		}
+	}
+	return json.length();
+}
+
+// Returns the end of the JSON value starting at i
+size_t skipValue(const std::string& json, size_t i) {
+	int depth = 0;
+	for (; i < json.length(); i++) {
+		char c = json[i];
+		if (c == '"') {
+			i = skipString(json, i) - 1;
+			if (depth == 0) return i + 1;
+		} else if (c == '{' || c == '[') {
+			depth++;
+		} else if (c == '}' || c == ']') {
+			if (depth == 0) return i;
+			if (--depth == 0) return i + 1;
+		} else if (c == ',' && depth == 0) {
+			return i;
+		}
+	}
+	return json.length();
+}
+
+/*
+ * Drops the request and response headers from an http event, as they hold
+ * cookies and credentials that must not outlive the process. The event is
+ * the JSON.stringify() output of an object, so has no spaces between tokens.
+ */
+std::string withoutHeaders(const std::string& json) {
+	if (json.empty() || json[0] != '{') return json;
+	std::string result("{");
+	size_t i = 1;
+	while (i < json.length() && json[i] == '"') {
+		size_t keyEnd = skipString(json, i);
+		size_t valueEnd = skipValue(json, keyEnd + 1);
+		std::string key = json.substr(i, keyEnd - i);
+		if (key != "\"header\"" && key != "\"requestHeader\"") {
+			if (result.length() > 1) result.push_back(',');
+			result.append(json, i, valueEnd - i);
+		}
+		i = valueEnd;
+		if (i < json.length() && json[i] == ',') i++;
+	}
+	result.push_back('}');
+	return result;
+}
+
+// Keeps only the http events of an api payload of "topic:data" lines
+std::string httpEvents(const char *data, unsigned int size) {
+	std::string result;
+	std::string payload(data, size);
+	size_t start = 0;
+	while (start < payload.length()) {
+		size_t end = payload.find('\n', start);
+		if (end == std::string::npos) end = payload.length();
+		if (payload.compare(start, 5, "http:") == 0) {
+			result.append("http:");
+			result.append(withoutHeaders(payload.substr(start + 5, end - start - 5)));
+			result.push_back('\n');
+		}
+		start = end + 1;
+	}
+	return result;
+}
+
+void append(Ring& ring, uint8_t topic, const char *payload, unsigned int size) {
+	Header *h = header(ring);
+	uint64_t total = align(HISTORY_RECORD_HEADER_SIZE + size);
+	if (total > h->capacity) return;
+
+	// Drop the oldest records until there is room
+	while (h->head + total - h->tail > h->capacity) {
+		RecordHeader oldest;
+		copyOut(ring, h->tail, &oldest, sizeof(oldest));
+		h->tail += align(HISTORY_RECORD_HEADER_SIZE + oldest.length);
+		if (oldest.length > h->capacity || h->tail > h->head) {
+			// Damaged by a crash part way through a write, start again
+			h->tail = h->head;
+		}
+	}
+
+	RecordHeader record;
+	memset(&record, 0, sizeof(record));
+	record.length = size;
+	record.topic = topic;
+	record.time = now();
+	copyIn(ring, h->head, &record, sizeof(record));
+	copyIn(ring, h->head + HISTORY_RECORD_HEADER_SIZE, payload, size);
+	// Only publish the record once it is complete
+	h->head += total;
+}
+
+} /* anonymous namespace */
+
+int start(const std::string& dir, const std::string& name, unsigned long long capacity) {
+	uv_once(&mutexOnce, initMutex);
+	capacity = align(capacity < HISTORY_MIN_CAPACITY ? HISTORY_MIN_CAPACITY : capacity);
+
+	uv_mutex_lock(&mutex);
+	int opened = 0;
+	if (!running) {
+		for (int i = 0; i < RING_COUNT; i++) {
+			std::stringstream path;
+			path << dir << '/' << name << '-' << rings[i].name << ".ring";
+			if (!map(rings[i], path.str(), capacity)) {
+				// Another process with the same name has it, so use our own
+				std::stringstream pidPath;
+#if defined(_WINDOWS)
+				pidPath << dir << '/' << name << '-' << _getpid() << '-' << rings[i].name << ".ring";
+#else
+				pidPath << dir << '/' << name << '-' << getpid() << '-' << rings[i].name << ".ring";
+#endif
+				if (!map(rings[i], pidPath.str(), capacity)) continue;
+			}
+			opened++;
+		}
+		running = opened > 0;
+	}
+	uv_mutex_unlock(&mutex);
+	return opened;
+}
+
+void record(const char* topic, const char* data, unsigned int size) {
+	uv_once(&mutexOnce, initMutex);
+	for (int i = 0; i < TOPIC_COUNT; i++) {
+		if (strcmp(topics[i].name, topic) != 0) continue;
+		Ring& ring = rings[topics[i].ring];
+		std::string events;
+		if (topics[i].ring == HTTP) {
+			events = httpEvents(data, size);
+			if (events.empty()) return;
+			data = events.data();
+			size = events.length();
+		}
+		uv_mutex_lock(&mutex);
+		if (running && ring.base != NULL) {
+			append(ring, (uint8_t) i, data, size);
+		}
+		uv_mutex_unlock(&mutex);
+		return;
+	}
+}
+
+void stop() {
+	uv_once(&mutexOnce, initMutex);
+	uv_mutex_lock(&mutex);
+	for (int i = 0; i < RING_COUNT; i++) {
+		unmap(rings[i]);
+	}
+	running = false;
+	uv_mutex_unlock(&mutex);
+}
+
+bool read(const std::string& name, long long from, long long to, std::vector<Record>& records) {
+	uv_once(&mutexOnce, initMutex);
+	uv_mutex_lock(&mutex);
+	bool found = false;
+	for (int i = 0; i < RING_COUNT; i++) {
+		Ring& ring = rings[i];
+		if (name != ring.name || ring.base == NULL) continue;
+		found = true;
+		Header *h = header(ring);
+		for (uint64_t position = h->tail; position < h->head;) {
+			RecordHeader rh;
+			copyOut(ring, position, &rh, sizeof(rh));
+			if (rh.length > h->capacity) break;
+			if (rh.time >= from && rh.time <= to && rh.topic < TOPIC_COUNT) {
+				Record result;
+				result.time = rh.time;
+				result.topic = topics[rh.topic].name;
+				result.data.resize(rh.length);
+				if (rh.length > 0) {
+					copyOut(ring, position + HISTORY_RECORD_HEADER_SIZE, &result.data[0], rh.length);
+				}
+				records.push_back(result);
+			}
+			position += align(HISTORY_RECORD_HEADER_SIZE + rh.length);
+		}
+	}
+	uv_mutex_unlock(&mutex);
+	return found;
+}
+
+} /* namespace history */
@@ -0,0 +1,61 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+
+#ifndef HISTORY_H_
+#define HISTORY_H_
+
+#include <string>
+#include <vector>
+
+/*
+ * Keeps the recent payloads of the gc, loop, memory, cpu and http sources in
+ * fixed-size memory-mapped ring files, one per source, so they can be read
+ * back by a late subscriber and survive the process for post-mortem use.
+ *
+ * File layout (little-endian), read by lib/history.js:
+ *   header   "AMHR", u32 version, u64 capacity, u64 head, u64 tail, padding
+ *            to HISTORY_HEADER_SIZE bytes
+ *   data     capacity bytes used as a ring. head and tail are logical
+ *            offsets that only increase; a record at logical offset p is at
+ *            data + p % capacity and may wrap around the end.
+ *   record   u32 payload length, u8 topic, 3 bytes padding, i64 time in ms,
+ *            payload, padding to a multiple of 8 bytes
+ *
+ * Recording copies straight into the mapping with no allocation, except that
+ * only the http events of api payloads are kept, without their request and
+ * response headers. Rings are created 0600 and links are not followed.
+ * Thread-safe.
+ */
+namespace history {
+
+	struct Record {
+		long long time;
+		std::string topic;
+		std::string data;
+	};
+
+	// Opens or creates <dir>/<name>-<ring>.ring for each ring, each holding
+	// capacity bytes of records. Returns the number of rings opened.
+	int start(const std::string& dir, const std::string& name, unsigned long long capacity);
+	void record(const char* topic, const char* data, unsigned int size);
+	void stop();
+
+	// Appends the records of ring written between from and to inclusive
+	bool read(const std::string& ring, long long from, long long to, std::vector<Record>& records);
+
+} /* namespace history */
+#endif /* HISTORY_H_ */
@@ -0,0 +1,150 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+
+#include "httpsummary.h"
+#include <ctime>
+#include <map>
+#include <sstream>
+#include <vector>
+#include "uv.h"
+#include "rollup.h"
+#include "plugins/node/common/histogram.h"
+#if defined(_WINDOWS)
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+// Further urls are counted together under "*" for their method
+#define HTTPSUMMARY_MAX_ROUTES 1000
+
+namespace httpsummary {
+
+namespace {
+
+struct Route {
+	std::string method;
+	std::string url;
+	LatencyHistogram histogram;
+	std::map<int, unsigned long long> statuses;
+};
+
+std::vector<Route> routes;
+std::map<std::string, int> routeIds;
+bool running = false;
+Emitter emit = NULL;
+uv_timer_t *timer = NULL;
+unsigned int interval = 0;
+bool perRequestEvents = false;
+int64_t windowStart = 0;
+
+int64_t now() {
+#if defined(_WINDOWS)
+	SYSTEMTIME st;
+	GetSystemTime(&st);
+	return ((int64_t) std::time(NULL)) * 1000 + st.wMilliseconds;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return ((int64_t) tv.tv_sec) * 1000 + tv.tv_usec / 1000;
+#endif
+}
+
+int intern(const std::string& method, const std::string& url) {
+	std::string key = method + ' ' + url;
+	std::map<std::string, int>::iterator it = routeIds.find(key);
+	if (it != routeIds.end()) return it->second;
+	int id = routes.size();
+	routes.push_back(Route());
+	routes[id].method = method;
+	routes[id].url = url;
+	routeIds[key] = id;
+	return id;
+}
+
+void onTimer(uv_timer_t *handle) {
+	int64_t time = now();
+	std::stringstream out;
+	for (size_t i = 0; i < routes.size(); i++) {
+		Route& route = routes[i];
+		if (route.histogram.getCount() == 0) continue;
+		out << "HttpSummaryData," << windowStart << ',' << interval << ',' << route.method << ',';
+		for (std::map<int, unsigned long long>::iterator it = route.statuses.begin(); it != route.statuses.end(); ++it) {
+			if (it != route.statuses.begin()) out << ';';
+			out << it->first << ':' << it->second;
+		}
+		out << ',' << route.histogram.serialize() << ',' << route.url << '\n';
+		route.histogram.reset();
+		route.statuses.clear();
+	}
+	windowStart = time;
+	std::string lines = out.str();
+	if (!lines.empty() && emit != NULL) {
+		emit("http_summary", lines.c_str(), lines.length());
+	}
+}
+
+void cleanupHandle(uv_handle_t *handle) {
+	delete handle;
+}
+
+} /* anonymous namespace */
+
+void start(Emitter emitter, unsigned int summaryInterval, bool events) {
+	perRequestEvents = events;
+	if (running && summaryInterval == interval) return;
+	stop();
+	emit = emitter;
+	interval = summaryInterval;
+	windowStart = now();
+	timer = new uv_timer_t;
+	uv_timer_init(uv_default_loop(), timer);
+	uv_unref((uv_handle_t*) timer);
+	uv_timer_start(timer, onTimer, interval, interval);
+	running = true;
+}
+
+void stop() {
+	if (!running) return;
+	// Emit the requests of the current, partial interval
+	onTimer(timer);
+	uv_timer_stop(timer);
+	uv_close((uv_handle_t*) timer, cleanupHandle);
+	timer = NULL;
+	running = false;
+	for (size_t i = 0; i < routes.size(); i++) {
+		routes[i].histogram.reset();
+		routes[i].statuses.clear();
+	}
+}
+
+int route(const std::string& method, const std::string& url) {
+	std::map<std::string, int>::iterator it = routeIds.find(method + ' ' + url);
+	if (it != routeIds.end()) return it->second;
+	if (routes.size() >= HTTPSUMMARY_MAX_ROUTES) return intern(method, "*");
+	return intern(method, url);
+}
+
+void record(int id, double duration, int status, bool http) {
+	if (!running || id < 0 || (size_t) id >= routes.size()) return;
+	Route& route = routes[id];
+	route.histogram.record(duration);
+	route.statuses[status]++;
+	if (http && !perRequestEvents) rollup::recordHttp(duration);
+}
+
+} /* namespace httpsummary */
@@ -0,0 +1,50 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+
+#ifndef HTTPSUMMARY_H_
+#define HTTPSUMMARY_H_
+
+#include <string>
+
+/*
+ * Per-route http response time and status code counts, kept natively so the
+ * http probes can record a request without building an event for it.
+ *
+ * A route is a method and filtered url, resolved to an integer id once by
+ * route(). Every interval each route with requests is emitted on the
+ * "http_summary" source as
+ *   HttpSummaryData,start,interval,method,status:n;...,count;sum;min;max;le:n;...;inf:n,url
+ * with the histogram in the format of plugins/node/common/histogram.h. The
+ * url is last as it may contain commas.
+ *
+ * All functions must be called on the event loop thread.
+ */
+namespace httpsummary {
+
+	typedef void (*Emitter)(const char* source, const char* data, unsigned int size);
+
+	// When the per-request http events are still emitted, rollup.h sees the
+	// response times in them, otherwise they are passed on from record().
+	// Either way rollup.h only sees requests to http, not https, servers.
+	void start(Emitter emitter, unsigned int interval, bool events);
+	// Emits the current, partial interval
+	void stop();
+	int route(const std::string& method, const std::string& url);
+	void record(int route, double duration, int status, bool http);
+
+} /* namespace httpsummary */
+#endif /* HTTPSUMMARY_H_ */
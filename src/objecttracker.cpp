@@ -21,137 +21,514 @@
 #include "v8.h"
 #include "v8-profiler.h"
 #include "nan.h"
+#include "objecttracker.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 using namespace v8;
 //Only perform object tracking on node v0.11 +
 #if NODE_VERSION_AT_LEAST(0, 11, 0)
-/* Take a heap snapshot and convert it into a histogram giving the counts and sizes
- * of every type of object on the heap.
+
+namespace objecttracker {
+
+/* v8-profiler.h says that kObject is "A JS object (except for arrays and strings)."
+ * so we should include strings and arrays as objects in the histogram as they are
+ * objects as the user understands them.
+ * When you take a heap dump in Chrome dev tools and then view it the
+ * names "(string)" and "(array)" are used for these, so that's what we'll show the user.
  */
-NAN_METHOD(getObjectHistogram) {
+static const char* STRING_NAME = "(string)";
+static const char* ARRAY_NAME = "(array)";
 
-	Isolate *isolate =  info.GetIsolate();
-	if (isolate == NULL) {
-		return;
-	}
+/* Snapshot nodes walked per handle scope. */
+static const int HISTOGRAM_BATCH_SIZE = 4096;
+
+/* Options are counts, so anything that can't be converted exactly, such as
+ * NaN or Infinity, is rejected rather than truncated.
+ */
+static const double MAX_SAFE_INTEGER = 9007199254740991.0;
+
+/* A histogram bucket while the snapshot is being walked. The snapshot
+ * internalizes node names so every node of a given type hands back the same
+ * string, which lets us match buckets on string identity rather than content.
+ */
+struct Bucket {
+	Nan::Global<String> name;
+	int64_t count;
+	int64_t size;
+};
+
+static std::string toStdString(Local<String> s) {
+	Nan::Utf8String utf8(s);
+	return std::string(*utf8, utf8.length());
+}
 
+static const HeapSnapshot* takeSnapshot(Isolate* isolate) {
 	HeapProfiler *heapProfiler = isolate->GetHeapProfiler();
-	Local<Context> currentContext = isolate->GetCurrentContext();
 
 #if NODE_VERSION_AT_LEAST(4, 0, 0) // > v4.00+
 	// Title field removed in Node 4.x
+	return heapProfiler->TakeHeapSnapshot();
 #else
 	Local<String> snapshotName = String::NewFromUtf8(isolate, "snapshot");
+	return heapProfiler->TakeHeapSnapshot(snapshotName);
 #endif
+}
 
-	/* TakeHeapSnapshot used to be called TakeSnapshot
-	 * It's arguments changed so the latest versions don't need a title param.
-	 */
-#if NODE_VERSION_AT_LEAST(0, 11, 0) // > v0.11+
-	const HeapSnapshot* snapshot = heapProfiler->TakeHeapSnapshot(
-#else
-	const HeapSnapshot* snapshot = heapProfiler->TakeSnapshot(snapshotName);
-#endif
-#if NODE_VERSION_AT_LEAST(4, 0, 0) // > v4.0+
-	// Title field removed in Node 4.x
-#else
-	snapshotName
-#endif
-	);
+/* Take a heap snapshot and aggregate it into a histogram giving the counts and
+ * sizes of every type of object on the heap. The aggregation is done entirely
+ * in native memory, no JavaScript objects are created per heap node.
+ */
+void CollectHistogram(Isolate* isolate, std::vector<HistogramEntry>& result) {
+	const HeapSnapshot* snapshot = takeSnapshot(isolate);
 
-	/* Build a simple histogram from the heap snapshot. */
-	Local<Object> histogram = Object::New(isolate);
-#if NODE_VERSION_AT_LEAST(13, 0, 0) // > v13.0+
+	int64_t stringCount = 0, stringSize = 0;
+	int64_t arrayCount = 0, arraySize = 0;
 
-	/* Declare our tuple keys outside the loop. */
-	Local<String> countName = String::NewFromUtf8(isolate, "count").ToLocalChecked();
-	Local<String> sizeName = String::NewFromUtf8(isolate, "size").ToLocalChecked();
-
-	/* v8-profiler.h says that kObject is "A JS object (except for arrays and strings)."
-	 * so we should include strings and arrays as objects in the histogram as they are
-	 * objects as the user understands them.
-	 * When you take a heap dump in Chrome dev tools and then view it the
-	 * names "(string)" and "(array)" are used for these, so that's what we'll show the user.
+	std::vector<Bucket> buckets;
+	std::unordered_multimap<int, size_t> index;
+	buckets.reserve(1024);
+	index.reserve(1024);
+
+	/* Walk every node by index (not id). GetName() is the only way to find a
+	 * node's type, so it is still called per object, but the handles are
+	 * released a batch of nodes at a time rather than with a scope per node,
+	 * and consecutive objects of the same type skip the hash and lookup.
 	 */
-	Local<String> stringName = String::NewFromUtf8(isolate, "(string)").ToLocalChecked();
-	Local<String> arrayName = String::NewFromUtf8(isolate, "(array)").ToLocalChecked();
-#else
-	Local<String> countName = String::NewFromUtf8(isolate, "count");
-	Local<String> sizeName = String::NewFromUtf8(isolate, "size");
-	Local<String> stringName = String::NewFromUtf8(isolate, "(string)");
-	Local<String> arrayName = String::NewFromUtf8(isolate, "(array)");
-#endif
+	const int nodesCount = snapshot->GetNodesCount();
+	for (int batchStart = 0; batchStart < nodesCount; batchStart += HISTOGRAM_BATCH_SIZE) {
+		Nan::HandleScope scope;
+		const int batchEnd = std::min(nodesCount, batchStart + HISTOGRAM_BATCH_SIZE);
+		Local<String> lastName;
+		size_t lastBucket = 0;
+
+		for (int i = batchStart; i < batchEnd; i++) {
+			const HeapGraphNode* node = snapshot->GetNode(i);
+			const int64_t shallowSize = static_cast<int64_t>(node->GetShallowSize());
+
+			switch (node->GetType()) {
+			case HeapGraphNode::kString:
+				stringCount++;
+				stringSize += shallowSize;
+				continue;
+			case HeapGraphNode::kArray:
+				arrayCount++;
+				arraySize += shallowSize;
+				continue;
+			case HeapGraphNode::kObject:
+				break;
+			default:
+				continue;
+			}
+
+			Local<String> name = node->GetName();
+			if (lastName.IsEmpty() || lastName != name) {
+				const int hash = name->GetIdentityHash();
+				bool found = false;
+				std::pair<std::unordered_multimap<int, size_t>::iterator,
+						std::unordered_multimap<int, size_t>::iterator> range = index.equal_range(hash);
+				for (std::unordered_multimap<int, size_t>::iterator it = range.first; it != range.second; ++it) {
+					if (buckets[it->second].name == name) {
+						lastBucket = it->second;
+						found = true;
+						break;
+					}
+				}
+				if (!found) {
+					lastBucket = buckets.size();
+					index.insert(std::make_pair(hash, lastBucket));
+					buckets.push_back(Bucket());
+					buckets.back().name.Reset(name);
+					buckets.back().count = 0;
+					buckets.back().size = 0;
+				}
+				lastName = name;
+			}
+			buckets[lastBucket].count++;
+			buckets[lastBucket].size += shallowSize;
+		}
+	}
 
-	/* Walk every node by index (not id) */
-	for(int i = 0; i < snapshot->GetNodesCount(); i++ ) {
-
-		const HeapGraphNode* node = snapshot->GetNode(i);
-
-		Local<String> name;
-		switch( node->GetType() ) {
-		case HeapGraphNode::kObject:
-			name = node->GetName();
-			break;
-		case HeapGraphNode::kString:
-			name = stringName;
-			break;
-		case HeapGraphNode::kArray:
-			name = arrayName;
-			break;
-		default:
+	// Delete the snapshot as soon as we are done with it.
+	const_cast<HeapSnapshot*>(snapshot)->Delete();
+
+	/* Only the distinct names are converted to native strings. Buckets that
+	 * didn't match on identity but have the same text are merged here.
+	 */
+	std::unordered_map<std::string, size_t> byName;
+	result.clear();
+	result.reserve(buckets.size() + 2);
+	for (size_t i = 0; i < buckets.size(); i++) {
+		Nan::HandleScope scope;
+		std::string name = toStdString(Nan::New(buckets[i].name));
+		buckets[i].name.Reset();
+		std::unordered_map<std::string, size_t>::iterator found = byName.find(name);
+		if (found != byName.end()) {
+			result[found->second].count += buckets[i].count;
+			result[found->second].size += buckets[i].size;
 			continue;
 		}
+		byName[name] = result.size();
+		HistogramEntry entry;
+		entry.name = name;
+		entry.count = buckets[i].count;
+		entry.size = buckets[i].size;
+		result.push_back(entry);
+	}
+	if (stringCount > 0) {
+		HistogramEntry entry;
+		entry.name = STRING_NAME;
+		entry.count = stringCount;
+		entry.size = stringSize;
+		result.push_back(entry);
+	}
+	if (arrayCount > 0) {
+		HistogramEntry entry;
+		entry.name = ARRAY_NAME;
+		entry.count = arrayCount;
+		entry.size = arraySize;
+		result.push_back(entry);
+	}
+}
 
-		Local<Value> tupleval = Nan::Get(histogram, name).ToLocalChecked();
-		Local<Object> tuple;
+static bool bySizeDescending(const HistogramEntry& a, const HistogramEntry& b) {
+	return a.size > b.size;
+}
 
-		int64_t ncount = 0;
-		int64_t nsize = 0;
-		if( !(tupleval->IsNull() || tupleval->IsUndefined()) ) {
-			tuple = Nan::To<Object>(tupleval).ToLocalChecked();
+static bool byCountDescending(const HistogramEntry& a, const HistogramEntry& b) {
+	return a.count > b.count;
+}
 
-			/* Nothing else can access the tuple or histogram objects,
-			 * if we've found an entry for "name" then it will have these
-			 * fields set. There's no need to check for null/undefined
-			 * from Get.
-			 */
-			Local<Value> count = Nan::Get(tuple, countName).ToLocalChecked();
-			ncount = count->IntegerValue(Nan::GetCurrentContext()).FromJust();
-			Local<Value> size = Nan::Get(tuple, sizeName).ToLocalChecked();
-			nsize = size->IntegerValue(Nan::GetCurrentContext()).FromJust();
+/* Sort (and optionally truncate) entries in native code so only the
+ * entries that will be returned are ever turned into JavaScript objects.
+ * A limit of 0 keeps every entry.
+ */
+void SortHistogram(std::vector<HistogramEntry>& entries, bool bySize, size_t limit) {
+	bool (*compare)(const HistogramEntry&, const HistogramEntry&) = bySize ? bySizeDescending : byCountDescending;
+	if (limit > 0 && limit < entries.size()) {
+		std::partial_sort(entries.begin(), entries.begin() + limit, entries.end(), compare);
+		entries.resize(limit);
+	} else {
+		std::sort(entries.begin(), entries.end(), compare);
+	}
+}
+
+static bool ToCount(Local<Value> value, double min, double max, double* result) {
+	if (!value->IsNumber()) {
+		return false;
+	}
+	double number = Nan::To<double>(value).FromJust();
+	if (!(number >= min && number <= max) || number != static_cast<double>(static_cast<int64_t>(number))) {
+		return false;
+	}
+	*result = number;
+	return true;
+}
 
+/* Read the { sortBy: 'size'|'count', limit: n } options object shared by
+ * getObjectHistogram and the histogram session. Returns false (with an
+ * exception pending) if the options are invalid.
+ */
+bool ParseSortOptions(Local<Value> arg, bool* sort, bool* bySize, size_t* limit) {
+	*sort = false;
+	*bySize = true;
+	*limit = 0;
+	if (arg->IsUndefined() || arg->IsNull()) {
+		return true;
+	}
+	if (!arg->IsObject()) {
+		Nan::ThrowTypeError("Options must be an object");
+		return false;
+	}
+	Local<Object> options = Nan::To<Object>(arg).ToLocalChecked();
+
+	Local<Value> sortBy = Nan::Get(options, Nan::New<String>("sortBy").ToLocalChecked()).ToLocalChecked();
+	if (!sortBy->IsUndefined()) {
+		Nan::Utf8String sortByString(sortBy);
+		if (strcmp(*sortByString, "size") == 0) {
+			*bySize = true;
+		} else if (strcmp(*sortByString, "count") == 0) {
+			*bySize = false;
 		} else {
-			/* Create a new tuple and add it to the histogram.
-			 * Number objects are immutable so we have to replace
-			 * existing values. There's no need to create initial
-			 * values for count and size.
-			 */
-			tuple = Object::New(isolate);
-#if NODE_VERSION_AT_LEAST(13, 0, 0) // > v13.0+
-			histogram->Set(currentContext, name, tuple);
+			Nan::ThrowRangeError("sortBy must be 'size' or 'count'");
+			return false;
 		}
+		*sort = true;
+	}
 
-		/* Update the values in the existing (or new) tuple */
-		Local<Value> newcount = Number::New(isolate, ++ncount);
-		tuple->Set(currentContext, countName, newcount);
-		Local<Value> newsize = Number::New(isolate, nsize+node->GetShallowSize());
-		tuple->Set(currentContext,sizeName, newsize);
-#else
-            histogram->Set(currentContext, name, tuple);
+	Local<Value> limitValue = Nan::Get(options, Nan::New<String>("limit").ToLocalChecked()).ToLocalChecked();
+	if (!limitValue->IsUndefined()) {
+		double value;
+		if (!ToCount(limitValue, 0, MAX_SAFE_INTEGER, &value)) {
+			Nan::ThrowRangeError("limit must be a non-negative integer");
+			return false;
 		}
+		*limit = static_cast<size_t>(value);
+		*sort = true;
+	}
+	return true;
+}
 
-		/* Update the values in the existing (or new) tuple */
-		Local<Value> newcount = Number::New(isolate, ++ncount);
-		tuple->Set(currentContext, countName, newcount);
-		Local<Value> newsize = Number::New(isolate, nsize+node->GetShallowSize());
-		tuple->Set(currentContext,sizeName, newsize);
-#endif
+/* A type whose count or size changed between two histogram samples. */
+struct HistogramChange {
+	std::string name;
+	int64_t count;
+	int64_t size;
+	int64_t countDelta;
+	int64_t sizeDelta;
+	uint32_t growth;
+	bool suspect;
+};
+
+static int64_t absolute(int64_t value) {
+	return value < 0 ? -value : value;
+}
+
+static bool changeOrderBySize(const HistogramChange& a, const HistogramChange& b) {
+	if (a.suspect != b.suspect) return a.suspect;
+	return absolute(a.sizeDelta) > absolute(b.sizeDelta);
+}
+
+static bool changeOrderByCount(const HistogramChange& a, const HistogramChange& b) {
+	if (a.suspect != b.suspect) return a.suspect;
+	return absolute(a.countDelta) > absolute(b.countDelta);
+}
+
+/* Retains the previous histogram between samples so that consumers only
+ * see the types whose count or size changed. A type that has grown in count
+ * for `window` consecutive samples is flagged as a leak suspect.
+ */
+class HistogramSession : public Nan::ObjectWrap {
+public:
+	static void Init(Local<Object> exports);
+
+private:
+	struct TypeState {
+		int64_t count;
+		int64_t size;
+		uint32_t growth;
+		uint32_t generation;
+	};
+
+	HistogramSession(uint32_t window, bool bySize, size_t limit)
+		: window_(window), bySize_(bySize), limit_(limit), generation_(0) {}
+
+	static NAN_METHOD(New);
+	static NAN_METHOD(Sample);
+	static NAN_METHOD(Reset);
+
+	void sample(Isolate* isolate, std::vector<HistogramChange>& changes);
+
+	uint32_t window_;
+	bool bySize_;
+	size_t limit_;
+	uint32_t generation_;
+	std::unordered_map<std::string, TypeState> types_;
+};
+
+void HistogramSession::sample(Isolate* isolate, std::vector<HistogramChange>& changes) {
+	std::vector<HistogramEntry> entries;
+	CollectHistogram(isolate, entries);
+
+	/* The first sample is only the baseline for the deltas. */
+	const bool baseline = (generation_ == 0);
+	generation_++;
+
+	for (size_t i = 0; i < entries.size(); i++) {
+		const HistogramEntry& entry = entries[i];
+		std::unordered_map<std::string, TypeState>::iterator it = types_.find(entry.name);
+		HistogramChange change;
+		if (it == types_.end()) {
+			TypeState state;
+			state.count = entry.count;
+			state.size = entry.size;
+			state.growth = baseline ? 0 : 1;
+			state.generation = generation_;
+			types_[entry.name] = state;
+			if (baseline) {
+				continue;
+			}
+			change.countDelta = entry.count;
+			change.sizeDelta = entry.size;
+			change.growth = state.growth;
+		} else {
+			TypeState& state = it->second;
+			change.countDelta = entry.count - state.count;
+			change.sizeDelta = entry.size - state.size;
+			state.growth = (change.countDelta > 0) ? state.growth + 1 : 0;
+			state.count = entry.count;
+			state.size = entry.size;
+			state.generation = generation_;
+			change.growth = state.growth;
+		}
+		change.suspect = (change.growth >= window_);
+		if (change.countDelta == 0 && change.sizeDelta == 0 && !change.suspect) {
+			continue;
+		}
+		change.name = entry.name;
+		change.count = entry.count;
+		change.size = entry.size;
+		changes.push_back(change);
 	}
 
-	// Delete the snapshot as soon as we are done with it.
-	heapProfiler->DeleteAllHeapSnapshots();
+	/* Types that weren't seen in this sample have been collected. */
+	std::unordered_map<std::string, TypeState>::iterator it = types_.begin();
+	while (it != types_.end()) {
+		if (it->second.generation == generation_) {
+			++it;
+			continue;
+		}
+		HistogramChange change;
+		change.name = it->first;
+		change.count = 0;
+		change.size = 0;
+		change.countDelta = -it->second.count;
+		change.sizeDelta = -it->second.size;
+		change.growth = 0;
+		change.suspect = false;
+		changes.push_back(change);
+		it = types_.erase(it);
+	}
+}
+
+void HistogramSession::Init(Local<Object> exports) {
+	Nan::HandleScope scope;
+	Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New);
+	tpl->SetClassName(Nan::New<String>("HistogramSession").ToLocalChecked());
+	tpl->InstanceTemplate()->SetInternalFieldCount(1);
+	Nan::SetPrototypeMethod(tpl, "sample", Sample);
+	Nan::SetPrototypeMethod(tpl, "reset", Reset);
+	Nan::Set(exports, Nan::New<String>("HistogramSession").ToLocalChecked(), Nan::GetFunction(tpl).ToLocalChecked());
+}
+
+/* new HistogramSession([{ window: n, sortBy: 'size'|'count', limit: n }]) */
+NAN_METHOD(HistogramSession::New) {
+	if (!info.IsConstructCall()) {
+		return Nan::ThrowError("HistogramSession must be called with new");
+	}
+
+	bool sort, bySize;
+	size_t limit;
+	if (!ParseSortOptions(info[0], &sort, &bySize, &limit)) {
+		return;
+	}
+
+	uint32_t window = 3;
+	if (info[0]->IsObject()) {
+		Local<Object> options = Nan::To<Object>(info[0]).ToLocalChecked();
+		Local<Value> windowValue = Nan::Get(options, Nan::New<String>("window").ToLocalChecked()).ToLocalChecked();
+		if (!windowValue->IsUndefined()) {
+			double value;
+			if (!ToCount(windowValue, 1, UINT32_MAX, &value)) {
+				return Nan::ThrowRangeError("window must be a positive integer");
+			}
+			window = static_cast<uint32_t>(value);
+		}
+	}
+
+	HistogramSession* session = new HistogramSession(window, bySize, limit);
+	session->Wrap(info.This());
+	info.GetReturnValue().Set(info.This());
+}
+
+/* Take a new histogram and return the types that changed since the last
+ * sample, leak suspects first and then largest change first.
+ */
+NAN_METHOD(HistogramSession::Sample) {
+	HistogramSession* session = Nan::ObjectWrap::Unwrap<HistogramSession>(info.Holder());
+
+	std::vector<HistogramChange> changes;
+	session->sample(info.GetIsolate(), changes);
+
+	if (session->bySize_) {
+		std::sort(changes.begin(), changes.end(), changeOrderBySize);
+	} else {
+		std::sort(changes.begin(), changes.end(), changeOrderByCount);
+	}
+	if (session->limit_ > 0 && session->limit_ < changes.size()) {
+		changes.resize(session->limit_);
+	}
+
+	Local<String> nameName = Nan::New<String>("name").ToLocalChecked();
+	Local<String> countName = Nan::New<String>("count").ToLocalChecked();
+	Local<String> sizeName = Nan::New<String>("size").ToLocalChecked();
+	Local<String> countDeltaName = Nan::New<String>("countDelta").ToLocalChecked();
+	Local<String> sizeDeltaName = Nan::New<String>("sizeDelta").ToLocalChecked();
+	Local<String> growthName = Nan::New<String>("growth").ToLocalChecked();
+	Local<String> suspectName = Nan::New<String>("suspect").ToLocalChecked();
+
+	Local<Array> result = Nan::New<Array>(static_cast<int>(changes.size()));
+	for (size_t i = 0; i < changes.size(); i++) {
+		const HistogramChange& change = changes[i];
+		Local<Object> entry = Nan::New<Object>();
+		Nan::Set(entry, nameName, Nan::New<String>(change.name).ToLocalChecked());
+		Nan::Set(entry, countName, Nan::New<Number>(static_cast<double>(change.count)));
+		Nan::Set(entry, sizeName, Nan::New<Number>(static_cast<double>(change.size)));
+		Nan::Set(entry, countDeltaName, Nan::New<Number>(static_cast<double>(change.countDelta)));
+		Nan::Set(entry, sizeDeltaName, Nan::New<Number>(static_cast<double>(change.sizeDelta)));
+		Nan::Set(entry, growthName, Nan::New<Number>(change.growth));
+		Nan::Set(entry, suspectName, Nan::New<Boolean>(change.suspect));
+		Nan::Set(result, static_cast<uint32_t>(i), entry);
+	}
+	info.GetReturnValue().Set(result);
+}
+
+/* Forget the retained histogram, the next sample becomes a new baseline. */
+NAN_METHOD(HistogramSession::Reset) {
+	HistogramSession* session = Nan::ObjectWrap::Unwrap<HistogramSession>(info.Holder());
+	session->types_.clear();
+	session->generation_ = 0;
+}
+
+void InitHistogramSession(Local<Object> exports) {
+	HistogramSession::Init(exports);
+}
+
+} /* end namespace objecttracker */
+
+/* Take a heap snapshot and convert it into a histogram giving the counts and sizes
+ * of every type of object on the heap.
+ *
+ * An optional { sortBy: 'size'|'count', limit: n } argument sorts the histogram
+ * (largest first) and keeps only the top n types. The result keeps the same shape,
+ * an object keyed by type name with { count, size } values, in sorted order.
+ */
+NAN_METHOD(getObjectHistogram) {
+
+	Isolate *isolate =  info.GetIsolate();
+	if (isolate == NULL) {
+		return;
+	}
+
+	bool sort, bySize;
+	size_t limit;
+	if (!objecttracker::ParseSortOptions(info[0], &sort, &bySize, &limit)) {
+		return;
+	}
+
+	std::vector<objecttracker::HistogramEntry> entries;
+	objecttracker::CollectHistogram(isolate, entries);
+	if (sort) {
+		objecttracker::SortHistogram(entries, bySize, limit);
+	}
+
+	/* Declare our tuple keys outside the loop. */
+	Local<String> countName = Nan::New<String>("count").ToLocalChecked();
+	Local<String> sizeName = Nan::New<String>("size").ToLocalChecked();
+
+	Local<Object> histogram = Nan::New<Object>();
+	for (size_t i = 0; i < entries.size(); i++) {
+		Local<Object> tuple = Nan::New<Object>();
+		Nan::Set(tuple, countName, Nan::New<Number>(static_cast<double>(entries[i].count)));
+		Nan::Set(tuple, sizeName, Nan::New<Number>(static_cast<double>(entries[i].size)));
+		Nan::Set(histogram, Nan::New<String>(entries[i].name).ToLocalChecked(), tuple);
+	}
 
 	info.GetReturnValue().Set(histogram);
 
 }
-#endif
\ No newline at end of file
+#endif
@@ -17,7 +17,25 @@
 #define objecttracker_hpp
 
 #include "nan.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace objecttracker {
+
+	struct HistogramEntry {
+		std::string name;
+		int64_t count;
+		int64_t size;
+	};
+
+	void CollectHistogram(v8::Isolate* isolate, std::vector<HistogramEntry>& result);
+	void SortHistogram(std::vector<HistogramEntry>& entries, bool bySize, size_t limit);
+	bool ParseSortOptions(v8::Local<v8::Value> arg, bool* sort, bool* bySize, size_t* limit);
+	void InitHistogramSession(v8::Local<v8::Object> exports);
+
+} /* namespace objecttracker */
 
 NAN_METHOD(getObjectHistogram);
 
-#endif /* objecttracker_hpp */
\ No newline at end of file
+#endif /* objecttracker_hpp */
@@ -0,0 +1,444 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+/*
+ * Allocation sampling plugin. Runs V8's sampling heap profiler continuously
+ * and periodically publishes the allocation-site tree. Unlike a heap snapshot
+ * this does not stop the world or duplicate the heap, so it is cheap enough
+ * to leave on.
+ */
+
+#include "ibmras/monitoring/AgentExtensions.h"
+#include "Typesdef.h"
+#include "v8.h"
+#include "v8-profiler.h"
+#include "uv.h"
+#include "nan.h"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sstream>
+#if defined(_WINDOWS)
+#include <ctime>
+#else
+#include <sys/time.h>
+#endif
+
+#define DEFAULT_CAPACITY 10240
+
+// V8's own default is 512KiB between samples
+#define DEFAULT_SAMPLE_INTERVAL 524288
+#define DEFAULT_REPORT_INTERVAL 60000
+#define DEFAULT_STACK_DEPTH 32
+
+#if defined(_WINDOWS)
+#define NODEALLOCPLUGIN_DECL __declspec(dllexport)	/* required for DLLs to export the plugin functions */
+#else
+#define NODEALLOCPLUGIN_DECL
+#endif
+
+#if defined(_WINDOWS)
+static unsigned long long GetRealTime() {
+	SYSTEMTIME st;
+	GetSystemTime(&st);
+	return std::time(NULL) * 1000 + st.wMilliseconds;
+}
+#else
+static unsigned long long GetRealTime() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (unsigned long long)(tv.tv_sec) * 1000 +
+	       (unsigned long long)(tv.tv_usec) / 1000;
+}
+#endif
+
+namespace plugin {
+	// NOTE: only access these variables from the V8/Node/uv thread
+	agentCoreFunctions api;
+	uint32 provid = 0;
+	bool enabled = false;
+	bool sampling = false;
+	// What the running profiler was started with
+	uint64_t samplingInterval = 0;
+	uv_timer_t *timer;
+}
+
+static uv_async_t *asyncEnable = NULL;
+static uv_async_t *asyncDisable = NULL;
+static uv_async_t *asyncReconfigure = NULL;
+
+using namespace v8;
+
+// Written from the agent thread and read on the V8 thread after a
+// uv_async_send(), so only accessed with settingsMutex held
+struct Settings {
+	uint64_t sampleInterval;
+	uint64_t reportInterval;
+};
+static uv_mutex_t settingsMutex;
+static Settings settings = { DEFAULT_SAMPLE_INTERVAL, DEFAULT_REPORT_INTERVAL };
+
+static Settings getSettings() {
+	uv_mutex_lock(&settingsMutex);
+	Settings result = settings;
+	uv_mutex_unlock(&settingsMutex);
+	return result;
+}
+
+static char* NewCString(const std::string& s) {
+	char *result = new char[s.length() + 1];
+	std::strcpy(result, s.c_str());
+	return result;
+}
+
+// NOTE: Must be called from the V8/Node/uv thread since it calls V8 APIs
+static std::string ToStdString(Local<String> v8string) {
+	Nan::Utf8String utf8(v8string);
+	if (*utf8 == NULL) return std::string();
+	std::string result(*utf8, utf8.length());
+	// The output is comma and newline delimited, so neither may appear in a field
+	for (std::string::size_type i = 0; i < result.size(); i++) {
+		if (result[i] == ',' || result[i] == '\n' || result[i] == '\r') {
+			result[i] = ' ';
+		}
+	}
+	return result;
+}
+
+// Emits one line per allocation site and returns the total bytes allocated
+// at the site and everything it calls. Children are written before their
+// parent since the total is not known until they have been visited; ids are
+// still assigned top-down so the parent id is always available.
+static uint64_t visit(const AllocationProfile::Node *node, int parentId, int *nextId,
+		std::stringstream &result) {
+	int id = (*nextId)++;
+
+	uint64_t selfBytes = 0;
+	uint64_t selfCount = 0;
+	for (size_t i = 0; i < node->allocations.size(); i++) {
+		const AllocationProfile::Allocation &allocation = node->allocations[i];
+		selfBytes += static_cast<uint64_t>(allocation.size) * allocation.count;
+		selfCount += allocation.count;
+	}
+
+	uint64_t totalBytes = selfBytes;
+	for (size_t i = 0; i < node->children.size(); i++) {
+		totalBytes += visit(node->children[i], id, nextId, result);
+	}
+
+	result << "NodeAllocData,Node," << id << ',' << parentId << ',';
+	result << ToStdString(node->script_name) << ',' << ToStdString(node->name) << ',';
+	result << node->line_number << ',' << selfBytes << ',' << totalBytes << ',' << selfCount << '\n';
+	return totalBytes;
+}
+
+static char* ConstructData(AllocationProfile *profile) {
+	std::stringstream result;
+	int nextId = 1;
+	result << "NodeAllocData,Start," << GetRealTime() << '\n';
+	visit(profile->GetRootNode(), 0, &nextId, result);
+	result << "NodeAllocData,End" << '\n';
+	return NewCString(result.str());
+}
+
+// NOTE: Must be called from the V8/Node/uv thread since it calls V8 APIs
+static Isolate* GetIsolate() {
+	Isolate *isolate = v8::Isolate::GetCurrent();
+	if (isolate == NULL) {
+		plugin::api.logMessage(loggingLevel::debug, "[allocation_node] No V8 Isolate found");
+	}
+	return isolate;
+}
+
+// NOTE: Must be called from the V8/Node/uv thread since it calls V8 APIs
+static void StartSampling(uint64_t sampleInterval) {
+	if (plugin::sampling) return;
+	Isolate *isolate = GetIsolate();
+	if (isolate == NULL) return;
+	plugin::samplingInterval = sampleInterval;
+	plugin::sampling = isolate->GetHeapProfiler()->StartSamplingHeapProfiler(
+			plugin::samplingInterval, DEFAULT_STACK_DEPTH);
+	if (!plugin::sampling) {
+		plugin::api.logMessage(warning, "[allocation_node] Unable to start the sampling heap profiler");
+	}
+}
+
+// NOTE: Must be called from the V8/Node/uv thread since it calls V8 APIs
+static void StopSampling() {
+	if (!plugin::sampling) return;
+	Isolate *isolate = GetIsolate();
+	if (isolate == NULL) return;
+	isolate->GetHeapProfiler()->StopSamplingHeapProfiler();
+	plugin::sampling = false;
+}
+
+// NOTE: Must be called from the V8/Node/uv thread since it calls V8 APIs
+static void collectData() {
+	if (!plugin::enabled || !plugin::sampling) return;
+
+	Isolate *isolate = GetIsolate();
+	if (isolate == NULL) return;
+
+	Nan::HandleScope scope;
+	AllocationProfile *profile = isolate->GetHeapProfiler()->GetAllocationProfile();
+	if (profile == NULL) {
+		plugin::api.logMessage(loggingLevel::debug, "[allocation_node] No allocation profile found");
+		return;
+	}
+
+	char *serialisedProfile = ConstructData(profile);
+	delete profile;
+
+	monitordata data;
+	data.persistent = false;
+	data.provID = plugin::provid;
+	data.sourceID = 0;
+	data.size = static_cast<uint32>(strlen(serialisedProfile));
+	data.data = serialisedProfile;
+	plugin::api.agentPushData(&data);
+
+	delete[] serialisedProfile;
+}
+
+#if NODE_VERSION_AT_LEAST(0, 11, 0) // > v0.11+
+static void OnGatherDataOnV8Thread(uv_timer_s *data) {
+#else
+static void OnGatherDataOnV8Thread(uv_timer_s *data, int status) {
+#endif
+	collectData();
+}
+
+pushsource* createPushSource(uint32 srcid, const char* name) {
+	pushsource *src = new pushsource();
+	src->header.name = name;
+	std::string desc("Description for ");
+	desc.append(name);
+	src->header.description = NewCString(desc);
+	src->header.sourceID = srcid;
+	src->next = NULL;
+	src->header.capacity = DEFAULT_CAPACITY;
+	return src;
+}
+
+static void publishEnabled() {
+	std::string sourceName = "allocation_node";
+	std::string msg = sourceName + "_subsystem=";
+	if (plugin::enabled) {
+		msg += "on";
+	} else {
+		msg += "off";
+	}
+
+	std::stringstream logMsg;
+	logMsg << "[allocation_node] Sending config message [" << msg << "]";
+	plugin::api.logMessage(loggingLevel::debug, logMsg.str().c_str());
+
+	plugin::api.agentSendMessage(("configuration/" + sourceName).c_str(), msg.length(),
+								  (void*) msg.c_str());
+}
+
+// NOTE: Must be called from the V8/Node/uv thread
+static void startTimer(uint64_t reportInterval) {
+	uv_timer_start(plugin::timer, OnGatherDataOnV8Thread, reportInterval, reportInterval);
+}
+
+#if NODE_VERSION_AT_LEAST(0, 11, 0) // > v0.11+
+static void enableOnV8Thread(uv_async_t *async) {
+#else
+static void enableOnV8Thread(uv_async_t *async, int status) {
+#endif
+	if (plugin::enabled) return;
+	plugin::enabled = true;
+	publishEnabled();
+	Settings current = getSettings();
+	StartSampling(current.sampleInterval);
+	startTimer(current.reportInterval);
+}
+
+#if NODE_VERSION_AT_LEAST(0, 11, 0) // > v0.11+
+static void disableOnV8Thread(uv_async_t *async) {
+#else
+static void disableOnV8Thread(uv_async_t *async, int status) {
+#endif
+	if (!plugin::enabled) return;
+	// Publish whatever has been sampled since the last report
+	collectData();
+	plugin::enabled = false;
+	publishEnabled();
+	uv_timer_stop(plugin::timer);
+	StopSampling();
+}
+
+// The sample interval can only be changed by restarting the profiler, which
+// discards the samples collected so far, so report them first. A new report
+// interval only needs the timer restarting.
+#if NODE_VERSION_AT_LEAST(0, 11, 0) // > v0.11+
+static void reconfigureOnV8Thread(uv_async_t *async) {
+#else
+static void reconfigureOnV8Thread(uv_async_t *async, int status) {
+#endif
+	if (!plugin::enabled) return;
+	Settings current = getSettings();
+	if (plugin::sampling && plugin::samplingInterval != current.sampleInterval) {
+		collectData();
+		StopSampling();
+	}
+	StartSampling(current.sampleInterval);
+	startTimer(current.reportInterval);
+}
+
+static void cleanupHandle(uv_handle_t *handle) {
+	delete handle;
+}
+
+// NOTE: Don't access plugin::enabled in here since this function may not be
+//       running on the V8/Node/uv thread. uv_async_send() is thread-safe.
+static void setEnabled(bool value) {
+	if (value) {
+		plugin::api.logMessage(fine, "[allocation_node] Enabling");
+		uv_async_send(asyncEnable);
+	} else {
+		plugin::api.logMessage(fine, "[allocation_node] Disabling");
+		uv_async_send(asyncDisable);
+	}
+}
+
+static bool parsePositive(const std::string &value, uint64_t *result) {
+	char *end = NULL;
+	unsigned long long parsed = std::strtoull(value.c_str(), &end, 10);
+	if (end == value.c_str() || *end != '\0' || parsed == 0) return false;
+	*result = parsed;
+	return true;
+}
+
+extern "C" {
+	NODEALLOCPLUGIN_DECL pushsource* ibmras_monitoring_registerPushSource(agentCoreFunctions api, uint32 provID) {
+		plugin::api = api;
+		uv_mutex_init(&settingsMutex);
+
+		std::string enabledProp(plugin::api.getProperty("com.ibm.diagnostics.healthcenter.data.allocation"));
+		plugin::enabled = (enabledProp == "on");
+
+		uint64_t value;
+		uv_mutex_lock(&settingsMutex);
+		if (parsePositive(plugin::api.getProperty("com.ibm.diagnostics.healthcenter.data.allocation.sample.interval"), &value)) {
+			settings.sampleInterval = value;
+		}
+		if (parsePositive(plugin::api.getProperty("com.ibm.diagnostics.healthcenter.data.allocation.interval"), &value)) {
+			settings.reportInterval = value;
+		}
+		uv_mutex_unlock(&settingsMutex);
+
+		plugin::api.logMessage(loggingLevel::debug, "[allocation_node] Registering push sources");
+		pushsource *head = createPushSource(0, "allocation_node");
+		plugin::provid = provID;
+		return head;
+	}
+
+	NODEALLOCPLUGIN_DECL int ibmras_monitoring_plugin_init(const char* properties) {
+		return 0;
+	}
+
+	// NOTE: Must be called from the V8/Node/uv thread since it calls
+	//       non thread-safe V8 and uv APIs
+	NODEALLOCPLUGIN_DECL int ibmras_monitoring_plugin_start() {
+		plugin::api.logMessage(fine, plugin::enabled ? "[allocation_node] Starting enabled"
+		                                             : "[allocation_node] Starting disabled");
+		publishEnabled();
+
+		plugin::timer = new uv_timer_t;
+		uv_timer_init(uv_default_loop(), plugin::timer);
+		uv_unref((uv_handle_t*) plugin::timer); // don't prevent event loop exit
+
+		asyncEnable = new uv_async_t;
+		uv_async_init(uv_default_loop(), asyncEnable, enableOnV8Thread);
+		uv_unref((uv_handle_t*) asyncEnable);
+
+		asyncDisable = new uv_async_t;
+		uv_async_init(uv_default_loop(), asyncDisable, disableOnV8Thread);
+		uv_unref((uv_handle_t*) asyncDisable);
+
+		asyncReconfigure = new uv_async_t;
+		uv_async_init(uv_default_loop(), asyncReconfigure, reconfigureOnV8Thread);
+		uv_unref((uv_handle_t*) asyncReconfigure);
+
+		if (plugin::enabled) {
+			Settings current = getSettings();
+			StartSampling(current.sampleInterval);
+			startTimer(current.reportInterval);
+		}
+		return 0;
+	}
+
+	NODEALLOCPLUGIN_DECL int ibmras_monitoring_plugin_stop() {
+		plugin::api.logMessage(fine, "[allocation_node] Stopping");
+
+		if (plugin::enabled) {
+			plugin::enabled = false;
+			uv_timer_stop(plugin::timer);
+			StopSampling();
+		}
+		uv_close((uv_handle_t*) plugin::timer, cleanupHandle);
+		uv_close((uv_handle_t*) asyncEnable, cleanupHandle);
+		uv_close((uv_handle_t*) asyncDisable, cleanupHandle);
+		uv_close((uv_handle_t*) asyncReconfigure, cleanupHandle);
+		return 0;
+	}
+
+	// Messages are of the form "<value>,<setting>" where setting is one of
+	// allocation_node_subsystem (on|off), allocation_node_sample_interval
+	// (bytes between samples) or allocation_node_interval (ms between reports).
+	NODEALLOCPLUGIN_DECL void ibmras_monitoring_receiveMessage(const char *id, uint32 size, void *data) {
+		std::string idstring(id);
+		if (idstring != "allocation_node") return;
+
+		std::string message((const char*) data, size);
+		std::size_t found = message.find(',');
+		if (found == std::string::npos) return;
+		std::string command = message.substr(0, found);
+		std::string rest = message.substr(found + 1);
+
+		if (rest == "allocation_node_subsystem") {
+			setEnabled(command == "on");
+			return;
+		}
+
+		uint64_t value;
+		if (!parsePositive(command, &value)) {
+			std::string msg = "[allocation_node] Ignoring invalid value [" + command + "] for [" + rest + "]";
+			plugin::api.logMessage(warning, msg.c_str());
+			return;
+		}
+		bool known = true;
+		uv_mutex_lock(&settingsMutex);
+		if (rest == "allocation_node_sample_interval") {
+			settings.sampleInterval = value;
+		} else if (rest == "allocation_node_interval") {
+			settings.reportInterval = value;
+		} else {
+			known = false;
+		}
+		uv_mutex_unlock(&settingsMutex);
+		if (!known) return;
+		if (asyncReconfigure != NULL) {
+			uv_async_send(asyncReconfigure);
+		}
+	}
+
+	NODEALLOCPLUGIN_DECL const char* ibmras_monitoring_getVersion() {
+		return "1.0";
+	}
+}
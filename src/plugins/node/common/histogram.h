@@ -0,0 +1,79 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#ifndef NODE_PLUGINS_COMMON_HISTOGRAM_H
+#define NODE_PLUGINS_COMMON_HISTOGRAM_H
+
+#include <sstream>
+#include <string>
+
+/*
+ * A fixed-bucket latency histogram in milliseconds, serialized as
+ *   count;sum;min;max;le1:n1;le2:n2;...;inf:n
+ * where each n is the number of values <= le and above the previous bound.
+ */
+class LatencyHistogram {
+public:
+	LatencyHistogram() { reset(); }
+
+	void record(double ms) {
+		if (count == 0 || ms < min) min = ms;
+		if (count == 0 || ms > max) max = ms;
+		count++;
+		sum += ms;
+		int i = 0;
+		while (i < BOUND_COUNT && ms > bound(i)) i++;
+		buckets[i]++;
+	}
+
+	void reset() {
+		count = 0;
+		sum = 0;
+		min = 0;
+		max = 0;
+		for (int i = 0; i <= BOUND_COUNT; i++) buckets[i] = 0;
+	}
+
+	unsigned long long getCount() const { return count; }
+
+	std::string serialize() const {
+		std::stringstream result;
+		result << count << ';' << sum << ';' << min << ';' << max;
+		for (int i = 0; i < BOUND_COUNT; i++) {
+			result << ';' << bound(i) << ':' << buckets[i];
+		}
+		result << ";inf:" << buckets[BOUND_COUNT];
+		return result.str();
+	}
+
+private:
+	static const int BOUND_COUNT = 15;
+
+	static double bound(int i) {
+		static const double bounds[BOUND_COUNT] = {
+			0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 25, 50, 100, 250, 500, 1000, 5000
+		};
+		return bounds[i];
+	}
+
+	unsigned long long count;
+	double sum;
+	double min;
+	double max;
+	unsigned long long buckets[BOUND_COUNT + 1];
+};
+
+#endif /* NODE_PLUGINS_COMMON_HISTOGRAM_H */
@@ -0,0 +1,206 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#if defined(_ZOS) && !defined(_XOPEN_SOURCE_EXTENDED)
+#define _XOPEN_SOURCE_EXTENDED 1
+#endif
+
+#include "plugins/node/common/hostfacts.h"
+#include "uv.h"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#if defined(_WINDOWS)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#if defined(_LINUX)
+#include <sstream>
+#include "plugins/node/common/procfile.h"
+#endif
+
+#define HOSTFACTS_REFRESH_INTERVAL 10000
+
+namespace hostfacts {
+
+namespace {
+	uint64 lastRefresh = 0;
+	bool refreshed = false;
+	int64 totalMemory = -1;
+	int cpuCount = 1;
+	int64 cgroupMemoryLimit = -1;
+	double cgroupCpuQuota = -1;
+
+#if defined(_LINUX)
+	ProcFile memoryLimitFile;
+	ProcFile memoryUsageFile;
+	ProcFile cpuQuotaFile;
+	ProcFile cpuPeriodFile;  // cgroup v1 only, v2 has both in cpu.max
+	bool cgroupV2 = false;
+	char buffer[4096];
+
+	int64 readNumber(ProcFile& file) {
+		if (!file.read(buffer, sizeof(buffer))) return -1;
+		if (strncmp(buffer, "max", 3) == 0) return -1;
+		char *end;
+		int64 value = strtoll(buffer, &end, 10);
+		return end == buffer ? -1 : value;
+	}
+
+	/*
+	 * Opens the memory and cpu controller files of the cgroup this process is
+	 * in. Inside a container the cgroup namespace usually makes that the root
+	 * of the mounted hierarchy, so fall back to the root if the path is
+	 * missing. cgroup v1 controllers take precedence on hybrid systems.
+	 */
+	void openCgroupFiles() {
+		ProcFile cgroups;
+		if (!cgroups.open("/proc/self/cgroup") || !cgroups.read(buffer, sizeof(buffer))) return;
+
+		std::string memoryPath, cpuPath, unifiedPath;
+		bool haveMemory = false, haveCpu = false, haveUnified = false;
+		std::istringstream lines(buffer);
+		std::string line;
+		while (std::getline(lines, line)) {
+			// hierarchy-ID:controller-list:cgroup-path
+			std::string::size_type first = line.find(':');
+			std::string::size_type second = line.find(':', first + 1);
+			if (first == std::string::npos || second == std::string::npos) continue;
+			std::string controllers = "," + line.substr(first + 1, second - first - 1) + ",";
+			std::string path = line.substr(second + 1);
+			if (line.compare(0, first, "0") == 0 && controllers == ",,") {
+				unifiedPath = path;
+				haveUnified = true;
+			}
+			if (controllers.find(",memory,") != std::string::npos) {
+				memoryPath = path;
+				haveMemory = true;
+			}
+			if (controllers.find(",cpu,") != std::string::npos) {
+				cpuPath = path;
+				haveCpu = true;
+			}
+		}
+
+		if (haveMemory) {
+			const std::string roots[] = { "/sys/fs/cgroup/memory" + memoryPath, "/sys/fs/cgroup/memory" };
+			for (int i = 0; i < 2 && !memoryUsageFile.isOpen(); i++) {
+				if (memoryUsageFile.open(roots[i] + "/memory.usage_in_bytes")) {
+					memoryLimitFile.open(roots[i] + "/memory.limit_in_bytes");
+				}
+			}
+		}
+		if (haveCpu) {
+			const std::string roots[] = { "/sys/fs/cgroup/cpu" + cpuPath, "/sys/fs/cgroup/cpu" };
+			for (int i = 0; i < 2 && !cpuQuotaFile.isOpen(); i++) {
+				if (cpuQuotaFile.open(roots[i] + "/cpu.cfs_quota_us")) {
+					cpuPeriodFile.open(roots[i] + "/cpu.cfs_period_us");
+				}
+			}
+		}
+		if (haveUnified) {
+			const std::string roots[] = { "/sys/fs/cgroup" + unifiedPath, "/sys/fs/cgroup" };
+			for (int i = 0; i < 2; i++) {
+				if (!haveMemory && !memoryUsageFile.isOpen() && memoryUsageFile.open(roots[i] + "/memory.current")) {
+					memoryLimitFile.open(roots[i] + "/memory.max");
+				}
+				if (!haveCpu && !cpuQuotaFile.isOpen() && cpuQuotaFile.open(roots[i] + "/cpu.max")) {
+					cgroupV2 = true;
+				}
+			}
+		}
+	}
+
+	double readCpuQuota() {
+		if (cgroupV2) {
+			// "<quota> <period>" or "max <period>"
+			if (!cpuQuotaFile.read(buffer, sizeof(buffer))) return -1;
+			if (strncmp(buffer, "max", 3) == 0) return -1;
+			char *end;
+			double quota = strtod(buffer, &end);
+			double period = strtod(end, NULL);
+			return (end == buffer || period <= 0) ? -1 : quota / period;
+		}
+		int64 quota = readNumber(cpuQuotaFile);
+		int64 period = readNumber(cpuPeriodFile);
+		return (quota <= 0 || period <= 0) ? -1 : (double) quota / period;
+	}
+#endif
+
+	int readCpuCount() {
+#if defined(_WINDOWS)
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwNumberOfProcessors;
+#else
+		long count = sysconf(_SC_NPROCESSORS_ONLN);
+		return count > 0 ? (int) count : 1;
+#endif
+	}
+
+	void refreshIfStale() {
+		uint64 now = uv_hrtime() / 1000000;
+		if (refreshed && now - lastRefresh < HOSTFACTS_REFRESH_INTERVAL) return;
+#if defined(_LINUX)
+		if (!refreshed) openCgroupFiles();
+#endif
+		refreshed = true;
+		lastRefresh = now;
+
+		uint64 total = uv_get_total_memory();
+		totalMemory = total > 0 ? (int64) total : -1;
+		cpuCount = readCpuCount();
+#if defined(_LINUX)
+		cgroupMemoryLimit = readNumber(memoryLimitFile);
+		// cgroup v1 reports "no limit" as a very large number
+		if (totalMemory > 0 && cgroupMemoryLimit >= totalMemory) cgroupMemoryLimit = -1;
+		cgroupCpuQuota = readCpuQuota();
+#endif
+	}
+}
+
+int64 getTotalMemory() {
+	refreshIfStale();
+	return totalMemory;
+}
+
+int64 getCgroupMemoryLimit() {
+	refreshIfStale();
+	return cgroupMemoryLimit;
+}
+
+int64 getCgroupMemoryUsage() {
+#if defined(_LINUX)
+	refreshIfStale();
+	return readNumber(memoryUsageFile);
+#else
+	return -1;
+#endif
+}
+
+int64 getEffectiveTotalMemory() {
+	refreshIfStale();
+	return cgroupMemoryLimit >= 0 ? cgroupMemoryLimit : totalMemory;
+}
+
+double getEffectiveCpuCount() {
+	refreshIfStale();
+	if (cgroupCpuQuota > 0 && cgroupCpuQuota < cpuCount) return cgroupCpuQuota;
+	return cpuCount;
+}
+
+}
@@ -0,0 +1,50 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#ifndef NODE_PLUGINS_COMMON_HOSTFACTS_H
+#define NODE_PLUGINS_COMMON_HOSTFACTS_H
+
+#include "Typesdef.h"
+
+/*
+ * Facts about the host and the container the process runs in, for use by
+ * native plugins without calling back into JavaScript.
+ *
+ * Values that rarely change (total memory, CPU count, cgroup limits) are
+ * cached and refreshed at most every HOSTFACTS_REFRESH_INTERVAL ms, so they
+ * are cheap to call on every sample. Not thread-safe: call from one thread.
+ */
+namespace hostfacts {
+
+	// Total RAM on the host in bytes, or -1 if unknown
+	int64 getTotalMemory();
+
+	// cgroup memory limit in bytes, or -1 if there is none (always -1 off Linux)
+	int64 getCgroupMemoryLimit();
+
+	// Memory charged to the cgroup in bytes, or -1 if unknown. Not cached.
+	int64 getCgroupMemoryUsage();
+
+	// The memory actually available to the process: the cgroup limit if
+	// there is one, otherwise the host total
+	int64 getEffectiveTotalMemory();
+
+	// The CPUs actually available to the process: the cgroup quota if it is
+	// lower than the CPU count, otherwise the CPU count
+	double getEffectiveCpuCount();
+}
+
+#endif /* NODE_PLUGINS_COMMON_HOSTFACTS_H */
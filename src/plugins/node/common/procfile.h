@@ -0,0 +1,73 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+#ifndef NODE_PLUGINS_COMMON_PROCFILE_H
+#define NODE_PLUGINS_COMMON_PROCFILE_H
+
+#if !defined(_WINDOWS)
+
+#include <cerrno>
+#include <cstddef>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+
+/*
+ * A /proc or /sys file that is opened once and re-read from the start on
+ * each sample. pread() at offset 0 makes the kernel regenerate the contents,
+ * so there is no open()/close() per sample.
+ */
+class ProcFile {
+public:
+	ProcFile() : fd(-1) {}
+	~ProcFile() { close(); }
+
+	bool open(const std::string& path) {
+		close();
+		fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		return fd != -1;
+	}
+
+	void close() {
+		if (fd != -1) ::close(fd);
+		fd = -1;
+	}
+
+	bool isOpen() const { return fd != -1; }
+
+	// Reads the whole file into buffer and NUL terminates it
+	bool read(char *buffer, size_t size) {
+		if (fd == -1) return false;
+		size_t total = 0;
+		while (total < size - 1) {
+			ssize_t n = pread(fd, buffer + total, size - 1 - total, total);
+			if (n == -1 && errno == EINTR) continue;
+			if (n <= 0) break;
+			total += n;
+		}
+		buffer[total] = '\0';
+		return total > 0;
+	}
+
+private:
+	int fd;
+	ProcFile(const ProcFile&);
+	ProcFile& operator=(const ProcFile&);
+};
+
+#endif /* !_WINDOWS */
+
+#endif /* NODE_PLUGINS_COMMON_PROCFILE_H */
@@ -0,0 +1,299 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+/*
+ * Linux per-thread CPU plugin. Samples utime/stime of every thread in the
+ * process from /proc/self/task/<tid>/stat and reports them grouped by thread
+ * name, so CPU used by the libuv threadpool, V8's platform and GC helper
+ * threads and worker threads can be told apart from the main thread.
+ *
+ * The task directory is only re-scanned when the number of threads in
+ * /proc/self/stat changes, differs from the number being sampled or a thread
+ * has exited, as another may have started in its place; otherwise the
+ * per-thread stat files are kept open and re-read with pread().
+ */
+
+#include "ibmras/monitoring/AgentExtensions.h"
+#include "Typesdef.h"
+#include "uv.h"
+#include "plugins/node/common/hostfacts.h"
+#include "plugins/node/common/procfile.h"
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <map>
+#include <sstream>
+#include <string>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define DEFAULT_CAPACITY 10240
+#define NODETHREADCPUPLUGIN_DECL
+#define THREADCPU_INTERVAL 5000 // Same as `eventloop` metric
+#define STAT_BUFFER_SIZE 1024
+
+namespace plugin {
+	agentCoreFunctions api;
+	uint32 provid = 0;
+	uv_timer_t *timer;
+}
+
+struct ThreadState {
+	ThreadState() : user(0), system(0), seen(false) {}
+	ProcFile file;  // closed when the thread is erased
+	std::string name;
+	uint64 user;    // clock ticks
+	uint64 system;  // clock ticks
+	bool seen;      // still present at the last scan
+};
+
+struct ThreadGroup {
+	ThreadGroup() : threads(0), user(0), system(0) {}
+	int threads;
+	uint64 user;    // clock ticks during the interval
+	uint64 system;
+};
+
+static std::map<int, ThreadState> threads;
+static ProcFile processStat;
+static long lastThreadCount = -1;
+static uint64 lastProcessUser = 0;
+static uint64 lastProcessSystem = 0;
+static uint64 lastSampleTime = 0;
+static double ticksPerSecond = 100;
+static int pid;
+static char buffer[STAT_BUFFER_SIZE];
+
+static char* NewCString(const std::string& s) {
+	char *result = new char[s.length() + 1];
+	std::strcpy(result, s.c_str());
+	return result;
+}
+
+static void cleanupHandle(uv_handle_t *handle) {
+	delete handle;
+}
+
+static int64 getTime() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return ((int64) tv.tv_sec)*1000 + tv.tv_usec/1000;
+}
+
+/*
+ * Parses a /proc stat line: "pid (comm) state ppid ...". comm may itself
+ * contain spaces and parentheses so the fields are found from the last ')'.
+ * utime, stime and num_threads are fields 14, 15 and 20.
+ */
+static bool parseStat(const char *stat, std::string *name, uint64 *user, uint64 *system, long *threadCount) {
+	const char *open = strchr(stat, '(');
+	const char *close = strrchr(stat, ')');
+	if (open == NULL || close == NULL || close < open) return false;
+	if (name != NULL) {
+		name->assign(open + 1, close - open - 1);
+		// The output is comma delimited
+		for (std::string::size_type i = 0; i < name->size(); i++) {
+			if ((*name)[i] == ',' || (*name)[i] == '\n') (*name)[i] = ' ';
+		}
+	}
+	// Field 3 (state) follows ") "
+	const char *p = close + 2;
+	int field = 3;
+	while (*p != '\0' && field < 14) {
+		if (*p++ == ' ') field++;
+	}
+	if (field != 14) return false;
+	char *end;
+	*user = strtoull(p, &end, 10);
+	*system = strtoull(end, &end, 10);
+	if (threadCount != NULL) {
+		// Skip cutime, cstime, priority, nice to reach num_threads
+		for (int i = 0; i < 4; i++) strtoll(end, &end, 10);
+		*threadCount = strtol(end, &end, 10);
+	}
+	return true;
+}
+
+static bool readThread(ThreadState& thread, uint64 *user, uint64 *system) {
+	if (!thread.file.read(buffer, sizeof(buffer))) return false;
+	return parseStat(buffer, &thread.name, user, system, NULL);
+}
+
+// Opens any threads started since the last scan and forgets those that exited
+static void scanThreads() {
+	for (std::map<int, ThreadState>::iterator it = threads.begin(); it != threads.end(); ++it) {
+		it->second.seen = false;
+	}
+
+	DIR *dir = opendir("/proc/self/task");
+	if (dir == NULL) return;
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		int tid = atoi(entry->d_name);
+		if (tid <= 0) continue;
+		std::map<int, ThreadState>::iterator it = threads.find(tid);
+		if (it != threads.end()) {
+			it->second.seen = true;
+			continue;
+		}
+		ThreadState& thread = threads[tid];
+		std::stringstream path;
+		path << "/proc/self/task/" << tid << "/stat";
+		// Start from the thread's current times so CPU used before it was
+		// found is not attributed to this interval
+		if (!thread.file.open(path.str()) || !readThread(thread, &thread.user, &thread.system)) {
+			threads.erase(tid);
+			continue;
+		}
+		thread.seen = true;
+	}
+	closedir(dir);
+
+	for (std::map<int, ThreadState>::iterator it = threads.begin(); it != threads.end();) {
+		if (!it->second.seen) {
+			threads.erase(it++);
+		} else {
+			++it;
+		}
+	}
+}
+
+static void GetThreadCPUInformation(uv_timer_s *data) {
+	uint64 now = uv_hrtime() / (1000*1000);
+	double seconds = (now - lastSampleTime) / 1000.0;
+	if (seconds <= 0) return;
+
+	uint64 processUser = lastProcessUser, processSystem = lastProcessSystem;
+	long threadCount = lastThreadCount;
+	if (processStat.read(buffer, sizeof(buffer))) {
+		parseStat(buffer, NULL, &processUser, &processSystem, &threadCount);
+	}
+
+	std::map<std::string, ThreadGroup> groups;
+	bool exited = false;
+	for (std::map<int, ThreadState>::iterator it = threads.begin(); it != threads.end();) {
+		ThreadState& thread = it->second;
+		uint64 user, system;
+		if (!readThread(thread, &user, &system)) {
+			// The thread has exited; its last interval is lost
+			threads.erase(it++);
+			exited = true;
+			continue;
+		}
+		ThreadGroup& group = groups[it->first == pid ? std::string("main") : thread.name];
+		group.threads++;
+		group.user += user - thread.user;
+		group.system += system - thread.system;
+		thread.user = user;
+		thread.system = system;
+		++it;
+	}
+
+	if (exited || threadCount != lastThreadCount || (long) threads.size() != threadCount) {
+		scanThreads();
+		lastThreadCount = threadCount;
+	}
+
+	// Values are the fraction of one CPU used over the interval
+	double scale = 1.0 / (ticksPerSecond * seconds);
+	std::stringstream contentss;
+	int64 time = getTime();
+	contentss << "NodeThreadCPUData," << time << ",(process),1,";
+	contentss << (processUser - lastProcessUser) * scale << ',';
+	contentss << (processSystem - lastProcessSystem) * scale << ',';
+	contentss << hostfacts::getEffectiveCpuCount() << '\n';
+	for (std::map<std::string, ThreadGroup>::iterator it = groups.begin(); it != groups.end(); ++it) {
+		contentss << "NodeThreadCPUData," << time << ',' << it->first << ',' << it->second.threads << ',';
+		contentss << it->second.user * scale << ',' << it->second.system * scale << '\n';
+	}
+	lastProcessUser = processUser;
+	lastProcessSystem = processSystem;
+	lastSampleTime = now;
+
+	std::string content = contentss.str();
+	monitordata mdata;
+	mdata.persistent = false;
+	mdata.provID = plugin::provid;
+	mdata.sourceID = 0;
+	mdata.size = static_cast<uint32>(content.length());
+	mdata.data = content.c_str();
+	plugin::api.agentPushData(&mdata);
+}
+
+pushsource* createPushSource(uint32 srcid, const char* name) {
+	pushsource *src = new pushsource();
+	src->header.name = name;
+	std::string desc("Description for ");
+	desc.append(name);
+	src->header.description = NewCString(desc);
+	src->header.sourceID = srcid;
+	src->next = NULL;
+	src->header.capacity = DEFAULT_CAPACITY;
+	return src;
+}
+
+extern "C" {
+	NODETHREADCPUPLUGIN_DECL pushsource* ibmras_monitoring_registerPushSource(agentCoreFunctions api, uint32 provID) {
+		plugin::api = api;
+		plugin::api.logMessage(loggingLevel::debug, "[threadcpu_node] Registering push sources");
+
+		pushsource *head = createPushSource(0, "threadcpu_node");
+		plugin::provid = provID;
+		return head;
+	}
+
+	NODETHREADCPUPLUGIN_DECL int ibmras_monitoring_plugin_init(const char* properties) {
+		return 0;
+	}
+
+	NODETHREADCPUPLUGIN_DECL int ibmras_monitoring_plugin_start() {
+		plugin::api.logMessage(fine, "[threadcpu_node] Starting");
+
+		pid = getpid();
+		long ticks = sysconf(_SC_CLK_TCK);
+		if (ticks > 0) ticksPerSecond = ticks;
+
+		if (!processStat.open("/proc/self/stat") || !processStat.read(buffer, sizeof(buffer))
+				|| !parseStat(buffer, NULL, &lastProcessUser, &lastProcessSystem, &lastThreadCount)) {
+			plugin::api.logMessage(warning, "[threadcpu_node] Unable to read /proc/self/stat");
+			return 0;
+		}
+		scanThreads();
+		lastSampleTime = uv_hrtime() / (1000*1000);
+
+		plugin::timer = new uv_timer_t;
+		uv_timer_init(uv_default_loop(), plugin::timer);
+		uv_unref((uv_handle_t*) plugin::timer); // don't prevent event loop exit
+		uv_timer_start(plugin::timer, GetThreadCPUInformation, THREADCPU_INTERVAL, THREADCPU_INTERVAL);
+		return 0;
+	}
+
+	NODETHREADCPUPLUGIN_DECL int ibmras_monitoring_plugin_stop() {
+		plugin::api.logMessage(fine, "[threadcpu_node] Stopping");
+		if (plugin::timer != NULL) {
+			uv_timer_stop(plugin::timer);
+			uv_close((uv_handle_t*) plugin::timer, cleanupHandle);
+			plugin::timer = NULL;
+		}
+		threads.clear();
+		processStat.close();
+		return 0;
+	}
+
+	NODETHREADCPUPLUGIN_DECL const char* ibmras_monitoring_getVersion() {
+		return "1.0";
+	}
+}
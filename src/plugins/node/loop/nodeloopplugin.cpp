@@ -18,15 +18,22 @@
 #include "Typesdef.h"
 #include "v8.h"
 #include "nan.h"
+#include "plugins/node/common/histogram.h"
+#include <cstdlib>
 #include <cstring>
 #include <sstream>
 #include <string>
+#include <vector>
 #if defined(_WINDOWS)
 #include <ctime>
 #else
 #include <sys/time.h>
 #include <sys/resource.h>
 #endif
+#if defined(_LINUX)
+#include <dirent.h>
+#include "plugins/node/common/procfile.h"
+#endif
 
 #define DEFAULT_CAPACITY 10240
 
@@ -37,6 +44,9 @@
 #endif
 
 #define LOOP_INTERVAL 5000 // Same as `eventloop` metric
+#define THREADPOOL_PROBE_INTERVAL 500 // Same as `eventloop` latency check
+#define DEFAULT_THREADPOOL_SIZE 4 // libuv's default
+#define MAX_THREADPOOL_SIZE 1024 // libuv's maximum
 namespace plugin {
 	agentCoreFunctions api;
 	uint32 provid = 0;
@@ -94,6 +104,181 @@ void getThreadCPUTime(uint64_t* cpu_user, uint64_t* cpu_sys) {
 #endif
 }
 
+/*
+ * Threadpool probes. A no-op work item is queued every
+ * THREADPOOL_PROBE_INTERVAL ms; the time until a worker picks it up is the
+ * queueing delay any fs, dns, crypto or zlib call would have seen, and the
+ * time from it finishing until the loop runs its completion callback is the
+ * delay before results are delivered. Only one probe is outstanding at a
+ * time: a probe still queued at the next interval is counted as stalled.
+ */
+namespace threadpool {
+	uv_timer_t *timer;
+	uv_work_t work;
+	bool pending = false;
+	uint64_t submitted = 0;
+	uint64_t started = 0; // written on the worker thread
+	LatencyHistogram queue;
+	LatencyHistogram completion;
+	uint64_t stalled = 0;
+	int size = DEFAULT_THREADPOOL_SIZE;
+	// Busy workers, sampled at each probe. Only available where libuv names
+	// its threads "libuv-worker" so they can be found in /proc.
+	uint64_t activeSum = 0;
+	uint64_t activeSamples = 0;
+	int activeMax = 0;
+}
+
+#if defined(_LINUX)
+namespace threadpool {
+	struct Worker {
+		ProcFile stat;
+		ProcFile wchan;
+	};
+	std::vector<Worker*> workers;
+	ProcFile processStat;
+	long lastThreadCount = -1;
+	char buffer[1024];
+
+	// Returns the character after the ") " that ends the comm field
+	const char* afterComm(const char *stat) {
+		const char *close = strrchr(stat, ')');
+		return (close != NULL && close[1] == ' ') ? close + 2 : NULL;
+	}
+
+	long readThreadCount() {
+		if (!processStat.read(buffer, sizeof(buffer))) return -1;
+		// num_threads is field 20, 17 fields after the state (field 3)
+		const char *p = afterComm(buffer);
+		for (int field = 3; p != NULL && field < 20; field++) {
+			p = strchr(p, ' ');
+			if (p != NULL) p++;
+		}
+		return p != NULL ? strtol(p, NULL, 10) : -1;
+	}
+
+	void scanWorkers() {
+		for (size_t i = 0; i < workers.size(); i++) delete workers[i];
+		workers.clear();
+		DIR *dir = opendir("/proc/self/task");
+		if (dir == NULL) return;
+		struct dirent *entry;
+		while ((entry = readdir(dir)) != NULL) {
+			if (entry->d_name[0] == '.') continue;
+			std::string task = std::string("/proc/self/task/") + entry->d_name;
+			ProcFile comm;
+			if (!comm.open(task + "/comm") || !comm.read(buffer, sizeof(buffer))) continue;
+			if (strncmp(buffer, "libuv-worker", 12) != 0) continue;
+			Worker *worker = new Worker();
+			if (!worker->stat.open(task + "/stat")) {
+				delete worker;
+				continue;
+			}
+			worker->wchan.open(task + "/wchan");
+			workers.push_back(worker);
+		}
+		closedir(dir);
+	}
+
+	// A worker is busy when running or in uninterruptible (disk) sleep, or
+	// sleeping anywhere other than the futex an idle worker waits on
+	bool isBusy(Worker *worker) {
+		if (!worker->stat.read(buffer, sizeof(buffer))) return false;
+		const char *state = afterComm(buffer);
+		if (state == NULL) return false;
+		if (*state == 'R' || *state == 'D') return true;
+		if (*state != 'S') return false;
+		if (!worker->wchan.read(buffer, sizeof(buffer))) return false;
+		return strcmp(buffer, "0") != 0 && strncmp(buffer, "futex", 5) != 0;
+	}
+
+	void sampleActiveWorkers() {
+		long threadCount = readThreadCount();
+		if (threadCount != lastThreadCount) {
+			scanWorkers();
+			lastThreadCount = threadCount;
+		}
+		if (workers.empty()) return;
+		int active = 0;
+		for (size_t i = 0; i < workers.size(); i++) {
+			if (isBusy(workers[i])) active++;
+		}
+		activeSum += active;
+		activeSamples++;
+		if (active > activeMax) activeMax = active;
+	}
+}
+#endif
+
+static void OnThreadpoolProbeWork(uv_work_t *req) {
+	threadpool::started = uv_hrtime();
+}
+
+#if NODE_VERSION_AT_LEAST(0, 11, 0) // > v0.11+
+static void OnThreadpoolProbeDone(uv_work_t *req, int status) {
+	uint64_t now = uv_hrtime();
+	threadpool::pending = false;
+	if (status != 0) return;
+	threadpool::queue.record((threadpool::started - threadpool::submitted) / 1e6);
+	threadpool::completion.record((now - threadpool::started) / 1e6);
+}
+
+static void OnThreadpoolProbe(uv_timer_s *data) {
+	if (threadpool::pending) {
+		threadpool::stalled++;
+	} else if (uv_queue_work(uv_default_loop(), &threadpool::work,
+			OnThreadpoolProbeWork, OnThreadpoolProbeDone) == 0) {
+		threadpool::pending = true;
+		threadpool::submitted = uv_hrtime();
+	}
+#if defined(_LINUX)
+	threadpool::sampleActiveWorkers();
+#endif
+}
+#endif
+
+static int getThreadpoolSize() {
+	const char *value = getenv("UV_THREADPOOL_SIZE");
+	if (value == NULL) return DEFAULT_THREADPOOL_SIZE;
+	int size = atoi(value);
+	if (size <= 0) return 1;
+	return size > MAX_THREADPOOL_SIZE ? MAX_THREADPOOL_SIZE : size;
+}
+
+static void pushThreadpoolInformation() {
+	if (threadpool::queue.getCount() == 0 && threadpool::stalled == 0) return;
+
+	std::stringstream contentss;
+	contentss << "NodeThreadpoolData";
+	contentss << "," << threadpool::size;
+	if (threadpool::activeSamples > 0) {
+		contentss << "," << ((double) threadpool::activeSum / threadpool::activeSamples);
+		contentss << "," << threadpool::activeMax;
+	} else {
+		contentss << ",-1,-1";
+	}
+	contentss << "," << threadpool::stalled;
+	contentss << "," << threadpool::queue.serialize();
+	contentss << "," << threadpool::completion.serialize();
+	contentss << '\n';
+
+	threadpool::queue.reset();
+	threadpool::completion.reset();
+	threadpool::stalled = 0;
+	threadpool::activeSum = 0;
+	threadpool::activeSamples = 0;
+	threadpool::activeMax = 0;
+
+	std::string content = contentss.str();
+	monitordata mdata;
+	mdata.persistent = false;
+	mdata.provID = plugin::provid;
+	mdata.sourceID = 0;
+	mdata.size = static_cast<uint32>(content.length());
+	mdata.data = content.c_str();
+	plugin::api.agentPushData(&mdata);
+}
+
 #if NODE_VERSION_AT_LEAST(0, 11, 0) // > v0.11+
 static void GetLoopInformation(uv_timer_s *data) {
 #else
@@ -142,6 +327,9 @@ static void GetLoopInformation(uv_timer_s *data, int status) {
 	  plugin::api.agentPushData(&mdata);
   }
 
+#if NODE_VERSION_AT_LEAST(0, 11, 0) // > v0.11+
+  pushThreadpoolInformation();
+#endif
 }
 
 pushsource* createPushSource(uint32 srcid, const char* name) {
@@ -201,6 +389,10 @@ extern "C" {
 		uv_timer_init(uv_default_loop(), plugin::timer);
 		uv_unref((uv_handle_t*) plugin::timer); // don't prevent event loop exit
 
+		threadpool::timer = new uv_timer_t;
+		uv_timer_init(uv_default_loop(), threadpool::timer);
+		uv_unref((uv_handle_t*) threadpool::timer);
+
 		return 0;
 	}
 
@@ -214,6 +406,14 @@ extern "C" {
 		uv_check_start(&check_handle, OnCheck);
 		uv_timer_start(plugin::timer, GetLoopInformation, LOOP_INTERVAL, LOOP_INTERVAL);
 
+#if NODE_VERSION_AT_LEAST(0, 11, 0) // > v0.11+
+		threadpool::size = getThreadpoolSize();
+#if defined(_LINUX)
+		threadpool::processStat.open("/proc/self/stat");
+#endif
+		uv_timer_start(threadpool::timer, OnThreadpoolProbe, THREADPOOL_PROBE_INTERVAL, THREADPOOL_PROBE_INTERVAL);
+#endif
+
 		return 0;
 	}
 
@@ -221,6 +421,7 @@ extern "C" {
 		plugin::api.logMessage(fine, "[loop_node] Stopping");
 
 		uv_timer_stop(plugin::timer);
+		uv_timer_stop(threadpool::timer);
 		uv_prepare_stop(&prepare_handle);
 		uv_check_stop(&check_handle);
 
@@ -0,0 +1,243 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+/*
+ * Linux memory plugin. Replaces the agentcore memory plugin on Linux so that
+ * the process figures come from /proc/self (including PSS and the anon/file/
+ * shmem split) and, inside a container, physical_total and physical_free are
+ * relative to the cgroup memory limit rather than the host's RAM.
+ *
+ * The /proc files are kept open as ProcFiles (common/procfile.h) and the
+ * cgroup figures come from common/hostfacts, so the plugin keeps no file
+ * handling of its own.
+ */
+
+#include "ibmras/monitoring/AgentExtensions.h"
+#include "Typesdef.h"
+#include "uv.h"
+#include "plugins/node/common/hostfacts.h"
+#include "plugins/node/common/procfile.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define DEFAULT_CAPACITY 10240
+#define NODELINUXMEMPLUGIN_DECL
+#define MEMORY_INTERVAL 2000
+#define PROC_BUFFER_SIZE 8192
+
+namespace plugin {
+	agentCoreFunctions api;
+	uint32 provid = 0;
+	uv_timer_t *timer;
+}
+
+// Constant strings for message composition
+const std::string COMMA = ",";
+const std::string EQUALS = "=";
+const std::string MEMORY_SOURCE = "MemorySource";
+const std::string TOTAL_MEMORY = "totalphysicalmemory";
+const std::string PHYSICAL_MEMORY = "physicalmemory";
+const std::string PRIVATE_MEMORY = "privatememory";
+const std::string VIRTUAL_MEMORY = "virtualmemory";
+const std::string FREE_PHYSICAL_MEMORY = "freephysicalmemory";
+const std::string PSS_MEMORY = "pss";
+const std::string ANON_MEMORY = "anon";
+const std::string FILE_MEMORY = "file";
+const std::string SHMEM_MEMORY = "shmem";
+const std::string HOST_TOTAL_MEMORY = "hosttotalmemory";
+const std::string CGROUP_LIMIT = "cgrouplimit";
+const std::string CGROUP_USAGE = "cgroupusage";
+
+static ProcFile statm;
+static ProcFile status;
+static ProcFile smapsRollup;
+static ProcFile meminfo;
+static int64 pageSize = 4096;
+static char buffer[PROC_BUFFER_SIZE];
+
+static char* NewCString(const std::string& s) {
+	char *result = new char[s.length() + 1];
+	std::strcpy(result, s.c_str());
+	return result;
+}
+
+static void cleanupHandle(uv_handle_t *handle) {
+	delete handle;
+}
+
+static int64 getTime() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return ((int64) tv.tv_sec)*1000 + tv.tv_usec/1000;
+}
+
+// Finds "<key>: <value> kB" in a /proc/self/status style file, returning
+// the value in bytes or -1 if the key is not present
+static int64 findKiBField(const char *text, const char *key) {
+	size_t keyLength = strlen(key);
+	const char *line = text;
+	while (line != NULL && *line != '\0') {
+		if (strncmp(line, key, keyLength) == 0 && line[keyLength] == ':') {
+			return strtoll(line + keyLength + 1, NULL, 10) * 1024;
+		}
+		line = strchr(line, '\n');
+		if (line != NULL) line++;
+	}
+	return -1;
+}
+
+static void GetMemoryInformation(uv_timer_s *data) {
+	int64 virtualMemory = -1, physicalMemory = -1, privateMemory = -1;
+	if (statm.read(buffer, sizeof(buffer))) {
+		// size resident shared text lib data dt, in pages
+		long long size = 0, resident = 0, shared = 0;
+		if (sscanf(buffer, "%lld %lld %lld", &size, &resident, &shared) == 3) {
+			virtualMemory = size * pageSize;
+			physicalMemory = resident * pageSize;
+			privateMemory = (resident - shared) * pageSize;
+		}
+	}
+
+	int64 anon = -1, file = -1, shmem = -1;
+	if (status.read(buffer, sizeof(buffer))) {
+		anon = findKiBField(buffer, "RssAnon");
+		file = findKiBField(buffer, "RssFile");
+		shmem = findKiBField(buffer, "RssShmem");
+	}
+
+	int64 pss = -1;
+	if (smapsRollup.read(buffer, sizeof(buffer))) {
+		pss = findKiBField(buffer, "Pss");
+		int64 privateClean = findKiBField(buffer, "Private_Clean");
+		int64 privateDirty = findKiBField(buffer, "Private_Dirty");
+		if (privateClean >= 0 && privateDirty >= 0) {
+			privateMemory = privateClean + privateDirty;
+		}
+	}
+
+	int64 hostFree = -1;
+	if (meminfo.read(buffer, sizeof(buffer))) {
+		hostFree = findKiBField(buffer, "MemAvailable");
+		if (hostFree < 0) hostFree = findKiBField(buffer, "MemFree");
+	}
+
+	int64 hostTotal = hostfacts::getTotalMemory();
+	int64 limit = hostfacts::getCgroupMemoryLimit();
+	int64 usage = hostfacts::getCgroupMemoryUsage();
+	int64 total = hostfacts::getEffectiveTotalMemory();
+	int64 free = hostFree;
+	if (limit >= 0) {
+		if (usage >= 0) {
+			free = limit > usage ? limit - usage : 0;
+			if (hostFree >= 0 && hostFree < free) free = hostFree;
+		}
+	}
+
+	std::stringstream contentss;
+	contentss << MEMORY_SOURCE << COMMA;
+	contentss << getTime() << COMMA;
+	contentss << TOTAL_MEMORY    << EQUALS << total          << COMMA;
+	contentss << PHYSICAL_MEMORY << EQUALS << physicalMemory << COMMA;
+	contentss << PRIVATE_MEMORY  << EQUALS << privateMemory  << COMMA;
+	contentss << VIRTUAL_MEMORY  << EQUALS << virtualMemory  << COMMA;
+	contentss << FREE_PHYSICAL_MEMORY << EQUALS << free      << COMMA;
+	contentss << PSS_MEMORY      << EQUALS << pss            << COMMA;
+	contentss << ANON_MEMORY     << EQUALS << anon           << COMMA;
+	contentss << FILE_MEMORY     << EQUALS << file           << COMMA;
+	contentss << SHMEM_MEMORY    << EQUALS << shmem          << COMMA;
+	contentss << HOST_TOTAL_MEMORY << EQUALS << hostTotal    << COMMA;
+	contentss << CGROUP_LIMIT    << EQUALS << limit          << COMMA;
+	contentss << CGROUP_USAGE    << EQUALS << usage          << std::endl;
+
+	std::string content = contentss.str();
+	monitordata mdata;
+	mdata.persistent = false;
+	mdata.provID = plugin::provid;
+	mdata.sourceID = 0;
+	mdata.size = static_cast<uint32>(content.length());
+	mdata.data = content.c_str();
+
+	plugin::api.agentPushData(&mdata);
+}
+
+pushsource* createPushSource(uint32 srcid, const char* name) {
+	pushsource *src = new pushsource();
+	src->header.name = name;
+	std::string desc("Memory plugin for Application Metrics for Node.js");
+	desc.append(name);
+	src->header.description = NewCString(desc);
+	src->header.sourceID = srcid;
+	src->next = NULL;
+	src->header.capacity = DEFAULT_CAPACITY;
+	return src;
+}
+
+extern "C" {
+	NODELINUXMEMPLUGIN_DECL pushsource* ibmras_monitoring_registerPushSource(agentCoreFunctions api, uint32 provID) {
+		plugin::api = api;
+		plugin::api.logMessage(loggingLevel::debug, "[memory_node] Registering push sources");
+
+		pushsource *head = createPushSource(0, "memory_node");
+		plugin::provid = provID;
+		return head;
+	}
+
+	NODELINUXMEMPLUGIN_DECL int ibmras_monitoring_plugin_init(const char* properties) {
+		return 0;
+	}
+
+	NODELINUXMEMPLUGIN_DECL int ibmras_monitoring_plugin_start() {
+		plugin::api.logMessage(fine, "[memory_node] Starting");
+
+		long size = sysconf(_SC_PAGESIZE);
+		if (size > 0) pageSize = size;
+		if (!statm.open("/proc/self/statm") || !status.open("/proc/self/status")) {
+			plugin::api.logMessage(warning, "[memory_node] Unable to open /proc/self");
+		}
+		// smaps_rollup needs Linux 4.14; without it PSS is not reported and
+		// private memory is estimated from statm
+		if (!smapsRollup.open("/proc/self/smaps_rollup")) {
+			plugin::api.logMessage(loggingLevel::debug, "[memory_node] /proc/self/smaps_rollup not available");
+		}
+		meminfo.open("/proc/meminfo");
+
+		plugin::timer = new uv_timer_t;
+		uv_timer_init(uv_default_loop(), plugin::timer);
+		uv_unref((uv_handle_t*) plugin::timer); // don't prevent event loop exit
+		uv_timer_start(plugin::timer, GetMemoryInformation, MEMORY_INTERVAL, MEMORY_INTERVAL);
+		return 0;
+	}
+
+	NODELINUXMEMPLUGIN_DECL int ibmras_monitoring_plugin_stop() {
+		plugin::api.logMessage(fine, "[memory_node] Stopping");
+		uv_timer_stop(plugin::timer);
+		uv_close((uv_handle_t*) plugin::timer, cleanupHandle);
+		statm.close();
+		status.close();
+		smapsRollup.close();
+		meminfo.close();
+		return 0;
+	}
+
+	NODELINUXMEMPLUGIN_DECL const char* ibmras_monitoring_getVersion() {
+		return "1.0";
+	}
+}
@@ -23,8 +23,8 @@
 
 #include "ibmras/monitoring/AgentExtensions.h"
 #include "Typesdef.h"
-#include "v8.h"
-#include "nan.h"
+#include "uv.h"
+#include "plugins/node/common/hostfacts.h"
 #include <cstring>
 #include <sstream>
 #include <string>
@@ -49,8 +49,6 @@ namespace plugin {
   uv_timer_t *timer;
 }
 
-using namespace v8;
-
 // Constant strings for message composition
 const std::string COMMA = ",";
 const std::string EQUALS = "=";
@@ -87,31 +85,7 @@ static int64 getTime() {
 }
 
 static int64 getTotalPhysicalMemorySize() {
-  plugin::api.logMessage(loggingLevel::debug, "[memory_node] >>getTotalPhysicalMemorySize()");
-  Nan::HandleScope scope;
-  Local<String> appmstr = Nan::New<String>("Appmetrics").ToLocalChecked();
-  Local<Value> appmval = Nan::Get(Nan::GetCurrentContext()->Global(), appmstr).ToLocalChecked();
-  Local<Object> appmobj = Nan::To<Object>(appmval).ToLocalChecked();
-
-  Local<String> fstr = Nan::New<String>("getTotalPhysicalMemorySize").ToLocalChecked();
-  Local<Value> totalMemValue = Nan::Get(appmobj, fstr).ToLocalChecked();
-  if (totalMemValue->IsFunction()) {
-    plugin::api.logMessage(loggingLevel::debug, "[memory_node] getTotalPhysicalMemorySize is a function");
-  } else {
-    plugin::api.logMessage(loggingLevel::debug, "[memory_node] getTotalPhysicalMemorySize is NOT a function");
-    return -1;
-  }
-  Local<Function> totalMemFunc = Local<Function>::Cast(totalMemValue);
-
-  Nan::Callback cb(totalMemFunc);
-  Local<Value> result = Nan::Call(cb, 0, 0).ToLocalChecked();
-  if (result->IsNumber()) {
-    plugin::api.logMessage(loggingLevel::debug, "[memory_node] result of calling getTotalPhysicalMemorySize is a number");
-    return result->IntegerValue(Nan::GetCurrentContext()).ToChecked();
-  } else {
-    plugin::api.logMessage(loggingLevel::debug, "[memory_node] result of calling getTotalPhysicalMemorySize is NOT a number");
-    return -1;
-  }
+  return hostfacts::getTotalMemory();
 }
 
 static int64 getProcessPhysicalMemorySize() {
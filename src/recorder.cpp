@@ -0,0 +1,471 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+
+#include "recorder.h"
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <sstream>
+#include <vector>
+#include "uv.h"
+#include "zlib.h"
+#if defined(_WINDOWS)
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+#define RECORDER_MAGIC "AMCR"
+#define RECORDER_INDEX_MAGIC "AMCI"
+#define RECORDER_VERSION 1
+#define RECORDER_CHUNK_ROWS 1024
+#define RECORDER_FLUSH_INTERVAL 60000 // ms a row may wait before its chunk is written
+
+namespace recorder {
+
+namespace {
+
+enum ColumnType {
+	COLUMN_INT = 0,
+	COLUMN_DOUBLE = 1,
+	COLUMN_STRING = 2
+};
+
+struct Series {
+	uint64_t id;
+	std::string source;
+	std::string name;
+	size_t columnCount;
+	std::vector<int64_t> times;
+	std::vector<std::vector<std::string> > columns;
+};
+
+struct ChunkIndex {
+	uint64_t series;
+	uint64_t offset;
+	int64_t minTime;
+	int64_t maxTime;
+	uint64_t rows;
+};
+
+uv_mutex_t mutex;
+bool mutexInitialized = false;
+FILE *output = NULL;
+uint64_t offset = 0;
+std::map<std::string, Series*> series;
+std::vector<ChunkIndex> index;
+
+int64_t now() {
+#if defined(_WINDOWS)
+	SYSTEMTIME st;
+	GetSystemTime(&st);
+	return ((int64_t) std::time(NULL)) * 1000 + st.wMilliseconds;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return ((int64_t) tv.tv_sec) * 1000 + tv.tv_usec / 1000;
+#endif
+}
+
+void putVarint(std::string& out, uint64_t value) {
+	while (value >= 0x80) {
+		out.push_back((char) ((value & 0x7f) | 0x80));
+		value >>= 7;
+	}
+	out.push_back((char) value);
+}
+
+void putSigned(std::string& out, int64_t value) {
+	putVarint(out, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+}
+
+void putString(std::string& out, const std::string& value) {
+	putVarint(out, value.length());
+	out.append(value);
+}
+
+class BitWriter {
+public:
+	BitWriter() : used(8) {}
+
+	void write(uint64_t value, int bits) {
+		for (int i = bits - 1; i >= 0; i--) {
+			if (used == 8) {
+				bytes.push_back(0);
+				used = 0;
+			}
+			if ((value >> i) & 1) {
+				bytes[bytes.length() - 1] |= (char) (0x80 >> used);
+			}
+			used++;
+		}
+	}
+
+	std::string bytes;
+
+private:
+	int used;
+};
+
+int leadingZeros(uint64_t value) {
+	int count = 0;
+	for (uint64_t bit = 1ULL << 63; bit != 0 && (value & bit) == 0; bit >>= 1) count++;
+	return count;
+}
+
+int trailingZeros(uint64_t value) {
+	int count = 0;
+	for (uint64_t bit = 1; bit != 0 && (value & bit) == 0; bit <<= 1) count++;
+	return count;
+}
+
+bool isInteger(const std::string& text) {
+	size_t start = (text.length() > 1 && text[0] == '-') ? 1 : 0;
+	size_t digits = text.length() - start;
+	if (digits == 0 || digits > 18) return false;
+	if (text[start] == '0' && digits > 1) return false;
+	for (size_t i = start; i < text.length(); i++) {
+		if (text[i] < '0' || text[i] > '9') return false;
+	}
+	return !(start == 1 && text == "-0");
+}
+
+bool isNumber(const std::string& text) {
+	if (text.empty() || text.find_first_not_of("0123456789.eE+-") != std::string::npos) return false;
+	char *end;
+	double value = strtod(text.c_str(), &end);
+	return *end == '\0' && std::isfinite(value);
+}
+
+ColumnType columnType(const std::vector<std::string>& column) {
+	bool integers = true;
+	for (size_t i = 0; i < column.size(); i++) {
+		if (integers && isInteger(column[i])) continue;
+		integers = false;
+		if (!isNumber(column[i])) return COLUMN_STRING;
+	}
+	return integers ? COLUMN_INT : COLUMN_DOUBLE;
+}
+
+void encodeIntegers(std::string& out, const std::vector<std::string>& column) {
+	int64_t previous = 0;
+	for (size_t i = 0; i < column.size(); i++) {
+		int64_t value = strtoll(column[i].c_str(), NULL, 10);
+		putSigned(out, value - previous);
+		previous = value;
+	}
+}
+
+// Gorilla encoding: each value is XORed with the previous one and only the
+// bits that differ are written
+void encodeDoubles(std::string& out, const std::vector<std::string>& column) {
+	BitWriter bits;
+	uint64_t previous = 0;
+	int previousLeading = -1, previousTrailing = 0;
+	for (size_t i = 0; i < column.size(); i++) {
+		double value = strtod(column[i].c_str(), NULL);
+		uint64_t current;
+		memcpy(&current, &value, sizeof(current));
+		if (i == 0) {
+			bits.write(current, 64);
+			previous = current;
+			continue;
+		}
+		uint64_t xored = current ^ previous;
+		previous = current;
+		if (xored == 0) {
+			bits.write(0, 1);
+			continue;
+		}
+		bits.write(1, 1);
+		int leading = leadingZeros(xored);
+		int trailing = trailingZeros(xored);
+		if (leading > 31) leading = 31;
+		if (previousLeading != -1 && leading >= previousLeading && trailing >= previousTrailing) {
+			bits.write(0, 1);
+			bits.write(xored >> previousTrailing, 64 - previousLeading - previousTrailing);
+		} else {
+			int significant = 64 - leading - trailing;
+			bits.write(1, 1);
+			bits.write(leading, 5);
+			bits.write(significant - 1, 6);
+			bits.write(xored >> trailing, significant);
+			previousLeading = leading;
+			previousTrailing = trailing;
+		}
+	}
+	putString(out, bits.bytes);
+}
+
+void encodeStrings(std::string& out, const std::vector<std::string>& column) {
+	std::map<std::string, uint64_t> dictionary;
+	std::vector<const std::string*> entries;
+	std::string indexes;
+	for (size_t i = 0; i < column.size(); i++) {
+		std::map<std::string, uint64_t>::iterator it = dictionary.find(column[i]);
+		if (it == dictionary.end()) {
+			it = dictionary.insert(std::make_pair(column[i], (uint64_t) entries.size())).first;
+			entries.push_back(&it->first);
+		}
+		putVarint(indexes, it->second);
+	}
+	putVarint(out, entries.size());
+	for (size_t i = 0; i < entries.size(); i++) {
+		putString(out, *entries[i]);
+	}
+	out.append(indexes);
+}
+
+bool write(const std::string& data) {
+	if (fwrite(data.data(), 1, data.length(), output) != data.length()) return false;
+	offset += data.length();
+	return true;
+}
+
+void writeSeries(std::string& out, const Series& s) {
+	out.push_back('S');
+	putVarint(out, s.id);
+	putString(out, s.source);
+	putString(out, s.name);
+	putVarint(out, s.columnCount);
+}
+
+void writeChunk(Series& s) {
+	if (s.times.empty()) return;
+	int64_t minTime = s.times[0], maxTime = s.times[0];
+	for (size_t i = 1; i < s.times.size(); i++) {
+		if (s.times[i] < minTime) minTime = s.times[i];
+		if (s.times[i] > maxTime) maxTime = s.times[i];
+	}
+
+	std::string raw;
+	int64_t previous = minTime;
+	for (size_t i = 0; i < s.times.size(); i++) {
+		putSigned(raw, s.times[i] - previous);
+		previous = s.times[i];
+	}
+	for (size_t c = 0; c < s.columnCount; c++) {
+		ColumnType type = columnType(s.columns[c]);
+		raw.push_back((char) type);
+		if (type == COLUMN_INT) {
+			encodeIntegers(raw, s.columns[c]);
+		} else if (type == COLUMN_DOUBLE) {
+			encodeDoubles(raw, s.columns[c]);
+		} else {
+			encodeStrings(raw, s.columns[c]);
+		}
+	}
+
+	uLongf compressedLength = compressBound(raw.length());
+	std::vector<Bytef> compressed(compressedLength);
+	if (compress2(&compressed[0], &compressedLength, (const Bytef*) raw.data(), raw.length(), Z_DEFAULT_COMPRESSION) != Z_OK) {
+		compressedLength = 0;
+	}
+
+	if (compressedLength > 0) {
+		ChunkIndex entry;
+		entry.series = s.id;
+		entry.offset = offset;
+		entry.minTime = minTime;
+		entry.maxTime = maxTime;
+		entry.rows = s.times.size();
+
+		std::string header;
+		header.push_back('C');
+		putVarint(header, s.id);
+		putVarint(header, entry.rows);
+		putSigned(header, minTime);
+		putVarint(header, maxTime - minTime);
+		putVarint(header, raw.length());
+		putVarint(header, compressedLength);
+		if (write(header) && write(std::string((const char*) &compressed[0], compressedLength))) {
+			index.push_back(entry);
+			// Keep what has been written readable if the process dies
+			fflush(output);
+		}
+	}
+
+	s.times.clear();
+	for (size_t c = 0; c < s.columnCount; c++) {
+		s.columns[c].clear();
+	}
+}
+
+void flushStale(int64_t time) {
+	for (std::map<std::string, Series*>::iterator it = series.begin(); it != series.end(); ++it) {
+		Series& s = *it->second;
+		if (!s.times.empty() && time - s.times[0] >= RECORDER_FLUSH_INTERVAL) {
+			writeChunk(s);
+		}
+	}
+}
+
+void recordLine(const char* source, const std::string& line, int64_t time) {
+	std::vector<std::string> fields;
+	std::string::size_type colon;
+	if (strcmp(source, "api") == 0 && (colon = line.find(':')) != std::string::npos) {
+		// api lines are "topic:json", so the topic names the series and the
+		// JSON, which has commas of its own, is one string column
+		fields.push_back(line.substr(0, colon));
+		fields.push_back(line.substr(colon + 1));
+	} else if (line[0] == '{' || line[0] == '[' || line.find(',') == std::string::npos) {
+		// JSON payloads and other lines that aren't comma separated are kept whole
+		fields.push_back("");
+		fields.push_back(line);
+	} else {
+		std::string::size_type start = 0, comma;
+		while ((comma = line.find(',', start)) != std::string::npos) {
+			fields.push_back(line.substr(start, comma - start));
+			start = comma + 1;
+		}
+		fields.push_back(line.substr(start));
+	}
+
+	std::stringstream key;
+	key << source << '\n' << fields[0] << '\n' << fields.size() - 1;
+	Series*& s = series[key.str()];
+	if (s == NULL) {
+		s = new Series();
+		s->id = series.size() - 1;
+		s->source = source;
+		s->name = fields[0];
+		s->columnCount = fields.size() - 1;
+		s->columns.resize(s->columnCount);
+		std::string definition;
+		writeSeries(definition, *s);
+		write(definition);
+	}
+
+	s->times.push_back(time);
+	for (size_t c = 0; c < s->columnCount; c++) {
+		s->columns[c].push_back(fields[c + 1]);
+	}
+	if (s->times.size() >= RECORDER_CHUNK_ROWS) {
+		writeChunk(*s);
+	}
+}
+
+void writeIndex() {
+	uint64_t indexOffset = offset;
+	std::string footer;
+	footer.push_back('I');
+	putVarint(footer, series.size());
+	std::vector<Series*> ordered(series.size());
+	for (std::map<std::string, Series*>::iterator it = series.begin(); it != series.end(); ++it) {
+		ordered[it->second->id] = it->second;
+	}
+	for (size_t i = 0; i < ordered.size(); i++) {
+		std::string definition;
+		writeSeries(definition, *ordered[i]);
+		footer.append(definition.substr(1));
+	}
+	putVarint(footer, index.size());
+	for (size_t i = 0; i < index.size(); i++) {
+		putVarint(footer, index[i].series);
+		putVarint(footer, index[i].offset);
+		putSigned(footer, index[i].minTime);
+		putVarint(footer, index[i].maxTime - index[i].minTime);
+		putVarint(footer, index[i].rows);
+	}
+	for (int i = 0; i < 8; i++) {
+		footer.push_back((char) ((indexOffset >> (8 * i)) & 0xff));
+	}
+	footer.append(RECORDER_INDEX_MAGIC);
+	write(footer);
+}
+
+} /* anonymous namespace */
+
+bool start(const std::string& file, std::string& error) {
+	if (!mutexInitialized) {
+		uv_mutex_init(&mutex);
+		mutexInitialized = true;
+	}
+	uv_mutex_lock(&mutex);
+	if (output != NULL) {
+		uv_mutex_unlock(&mutex);
+		error = "A recording is already in progress";
+		return false;
+	}
+	output = fopen(file.c_str(), "wb");
+	if (output == NULL) {
+		error = "Unable to open " + file + ": " + strerror(errno);
+		uv_mutex_unlock(&mutex);
+		return false;
+	}
+	offset = 0;
+	std::string header(RECORDER_MAGIC);
+	header.push_back((char) RECORDER_VERSION);
+	write(header);
+	uv_mutex_unlock(&mutex);
+	return true;
+}
+
+void record(const char* source, const char* data, unsigned int size) {
+	if (!mutexInitialized) return;
+	uv_mutex_lock(&mutex);
+	if (output != NULL) {
+		int64_t time = now();
+		std::string::size_type start = 0;
+		std::string payload(data, size);
+		while (start < payload.length()) {
+			std::string::size_type end = payload.find('\n', start);
+			if (end == std::string::npos) end = payload.length();
+			if (end > start) {
+				std::string line = payload.substr(start, end - start);
+				if (line[line.length() - 1] == '\r') line.erase(line.length() - 1);
+				if (!line.empty()) recordLine(source, line, time);
+			}
+			start = end + 1;
+		}
+		flushStale(time);
+	}
+	uv_mutex_unlock(&mutex);
+}
+
+void stop() {
+	if (!mutexInitialized) return;
+	uv_mutex_lock(&mutex);
+	if (output != NULL) {
+		for (std::map<std::string, Series*>::iterator it = series.begin(); it != series.end(); ++it) {
+			writeChunk(*it->second);
+		}
+		writeIndex();
+		fclose(output);
+		output = NULL;
+	}
+	for (std::map<std::string, Series*>::iterator it = series.begin(); it != series.end(); ++it) {
+		delete it->second;
+	}
+	series.clear();
+	index.clear();
+	uv_mutex_unlock(&mutex);
+}
+
+bool isRecording() {
+	if (!mutexInitialized) return false;
+	uv_mutex_lock(&mutex);
+	bool recording = output != NULL;
+	uv_mutex_unlock(&mutex);
+	return recording;
+}
+
+} /* namespace recorder */
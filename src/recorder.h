@@ -0,0 +1,47 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+
+#ifndef RECORDER_H_
+#define RECORDER_H_
+
+#include <string>
+
+/*
+ * Records the data pushed by the plugins to an append-only columnar file
+ * (the .amc format read by lib/columnar-reader.js).
+ *
+ * Each payload line "Name,field1,field2,..." is added to a series keyed by
+ * source, name and field count; api lines, "topic:json", get a series per
+ * topic with the JSON as one string column. Series are written in chunks of
+ * up to RECORDER_CHUNK_ROWS rows, one column at a time: integers as zigzag
+ * varint deltas, other numbers with Gorilla XOR encoding and everything else
+ * as dictionary indexes, then deflated. An index of the chunks and their time
+ * ranges is appended when recording stops so a reader only has to inflate the
+ * chunks it needs; without it (after a crash) the chunks can still be
+ * scanned in order.
+ *
+ * Thread-safe: record() may be called from any thread.
+ */
+namespace recorder {
+
+	bool start(const std::string& file, std::string& error);
+	void record(const char* source, const char* data, unsigned int size);
+	void stop();
+	bool isRecording();
+
+} /* namespace recorder */
+#endif /* RECORDER_H_ */
@@ -0,0 +1,295 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+
+#include "rollup.h"
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <sstream>
+#include <string>
+#include "uv.h"
+#include "plugins/node/common/histogram.h"
+#if defined(_WINDOWS)
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+#define ROLLUP_TIMER_INTERVAL 1000
+
+namespace rollup {
+
+namespace {
+
+enum Metric {
+	GC_DURATION, LOOP_AVERAGE, LOOP_MAXIMUM, HTTP_DURATION, CPU_PROCESS, CPU_SYSTEM, MEMORY_PHYSICAL, METRIC_COUNT
+};
+
+const char *metricNames[METRIC_COUNT] = {
+	"gc.duration", "loop.average", "loop.maximum", "http.duration", "cpu.process", "cpu.system", "memory.physical"
+};
+
+// The histogram buckets are for milliseconds, so cpu usage is recorded as a
+// percentage and memory in MB to spread them over the buckets too
+const double CPU_SCALE = 100;
+const double MEMORY_SCALE = 1.0 / (1024 * 1024);
+
+const int WINDOW_COUNT = 3;
+const int64_t windowLengths[WINDOW_COUNT] = { 1000, 10000, 60000 };
+
+struct Window {
+	Window() : start(0) {}
+	int64_t start;
+	LatencyHistogram histogram;
+};
+
+Window windows[METRIC_COUNT][WINDOW_COUNT];
+uv_mutex_t mutex;
+bool mutexInitialized = false;
+bool running = false;
+bool rawEvents = true;
+Emitter emit = NULL;
+uv_timer_t *timer = NULL;
+
+int64_t now() {
+#if defined(_WINDOWS)
+	SYSTEMTIME st;
+	GetSystemTime(&st);
+	return ((int64_t) std::time(NULL)) * 1000 + st.wMilliseconds;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return ((int64_t) tv.tv_sec) * 1000 + tv.tv_usec / 1000;
+#endif
+}
+
+void closeWindow(int metric, int w, std::string& out) {
+	Window& window = windows[metric][w];
+	if (window.histogram.getCount() > 0) {
+		std::stringstream line;
+		line << "RollupData," << metricNames[metric] << ',' << windowLengths[w] << ',' << window.start << ','
+			<< window.histogram.serialize() << '\n';
+		out.append(line.str());
+		window.histogram.reset();
+	}
+}
+
+void add(int metric, double value, int64_t time, std::string& out) {
+	for (int w = 0; w < WINDOW_COUNT; w++) {
+		Window& window = windows[metric][w];
+		int64_t start = time - time % windowLengths[w];
+		if (window.start != start) {
+			closeWindow(metric, w, out);
+			window.start = start;
+		}
+		window.histogram.record(value);
+	}
+}
+
+// Field index is 0 for the line name
+double field(const char *line, const char *end, int index) {
+	for (int i = 0; i < index && line < end; line++) {
+		if (*line == ',') i++;
+	}
+	return line < end ? strtod(line, NULL) : 0;
+}
+
+void addLines(const char *data, unsigned int size, int64_t time, std::string& out, bool gc) {
+	const char *end = data + size;
+	for (const char *line = data; line < end;) {
+		const char *next = static_cast<const char*>(memchr(line, '\n', end - line));
+		if (next == NULL) next = end;
+		if (gc && next - line > 11 && strncmp(line, "NodeGCData,", 11) == 0) {
+			// NodeGCData,time,type,size,used,duration
+			add(GC_DURATION, field(line, next, 5), time, out);
+		} else if (!gc && next - line > 13 && strncmp(line, "NodeLoopData,", 13) == 0) {
+			// NodeLoopData,min,max,count,average,...
+			add(LOOP_MAXIMUM, field(line, next, 2), time, out);
+			add(LOOP_AVERAGE, field(line, next, 4), time, out);
+		}
+		line = next + 1;
+	}
+}
+
+// startCPU@#time@#process@#system, where the usage is a fraction of the machine
+void addCpu(const char *data, unsigned int size, int64_t time, std::string& out) {
+	static const char prefix[] = "startCPU@#";
+	const char *end = data + size;
+	while (data < end && (*data == '\n' || *data == '\r' || *data == ' ')) data++;
+	if (end - data <= (int) sizeof(prefix) - 1 || memcmp(data, prefix, sizeof(prefix) - 1) != 0) return;
+	double values[3];
+	const char *p = data + sizeof(prefix) - 1;
+	for (int i = 0; i < 3; i++) {
+		values[i] = strtod(p, NULL);
+		if (i == 2) break;
+		const char *next = static_cast<const char*>(memchr(p, '@', end - p));
+		if (next == NULL || end - next < 3) return;
+		p = next + 2;
+	}
+	add(CPU_PROCESS, values[1] * CPU_SCALE, time, out);
+	add(CPU_SYSTEM, values[2] * CPU_SCALE, time, out);
+}
+
+// MemorySource,time,totalphysicalmemory=n,physicalmemory=n,...
+void addMemory(const char *data, unsigned int size, int64_t time, std::string& out) {
+	static const char prefix[] = "MemorySource,";
+	static const char key[] = ",physicalmemory=";
+	const char *end = data + size;
+	for (const char *line = data; line < end;) {
+		const char *next = static_cast<const char*>(memchr(line, '\n', end - line));
+		if (next == NULL) next = end;
+		if (next - line > (int) sizeof(prefix) - 1 && memcmp(line, prefix, sizeof(prefix) - 1) == 0) {
+			for (const char *p = line; p + sizeof(key) - 1 < next; p++) {
+				if (memcmp(p, key, sizeof(key) - 1) == 0) {
+					add(MEMORY_PHYSICAL, strtod(p + sizeof(key) - 1, NULL) * MEMORY_SCALE, time, out);
+					break;
+				}
+			}
+		}
+		line = next + 1;
+	}
+}
+
+// api payloads are "topic:json" lines; the http probe's include "duration":n
+void addHttp(const char *data, unsigned int size, int64_t time, std::string& out) {
+	const char *end = data + size;
+	static const char key[] = "\"duration\":";
+	for (const char *line = data; line < end;) {
+		const char *next = static_cast<const char*>(memchr(line, '\n', end - line));
+		if (next == NULL) next = end;
+		if (next - line > 5 && strncmp(line, "http:", 5) == 0) {
+			for (const char *p = line; p + sizeof(key) - 1 < next; p++) {
+				if (memcmp(p, key, sizeof(key) - 1) == 0) {
+					add(HTTP_DURATION, strtod(p + sizeof(key) - 1, NULL), time, out);
+					break;
+				}
+			}
+		}
+		line = next + 1;
+	}
+}
+
+void flush(const std::string& out) {
+	if (!out.empty() && emit != NULL) {
+		emit("rollup", out.c_str(), out.length());
+	}
+}
+
+// Closes windows that have ended without new data arriving
+void onTimer(uv_timer_t *handle) {
+	std::string out;
+	int64_t time = now();
+	uv_mutex_lock(&mutex);
+	for (int m = 0; m < METRIC_COUNT; m++) {
+		for (int w = 0; w < WINDOW_COUNT; w++) {
+			if (windows[m][w].start + windowLengths[w] <= time) {
+				closeWindow(m, w, out);
+			}
+		}
+	}
+	uv_mutex_unlock(&mutex);
+	flush(out);
+}
+
+void cleanupHandle(uv_handle_t *handle) {
+	delete handle;
+}
+
+} /* anonymous namespace */
+
+void start(Emitter emitter) {
+	if (running) return;
+	if (!mutexInitialized) {
+		uv_mutex_init(&mutex);
+		mutexInitialized = true;
+	}
+	emit = emitter;
+	timer = new uv_timer_t;
+	uv_timer_init(uv_default_loop(), timer);
+	uv_unref((uv_handle_t*) timer);
+	uv_timer_start(timer, onTimer, ROLLUP_TIMER_INTERVAL, ROLLUP_TIMER_INTERVAL);
+	running = true;
+}
+
+void stop() {
+	if (!running) return;
+	uv_timer_stop(timer);
+	uv_close((uv_handle_t*) timer, cleanupHandle);
+	timer = NULL;
+	// The current windows are emitted as they are, rather than lost
+	std::string out;
+	uv_mutex_lock(&mutex);
+	running = false;
+	for (int m = 0; m < METRIC_COUNT; m++) {
+		for (int w = 0; w < WINDOW_COUNT; w++) {
+			closeWindow(m, w, out);
+			windows[m][w].start = 0;
+		}
+	}
+	uv_mutex_unlock(&mutex);
+	flush(out);
+}
+
+void record(const char* source, const char* data, unsigned int size) {
+	if (!running) return;
+	bool gc = strcmp(source, "gc_node") == 0;
+	bool loop = strcmp(source, "loop_node") == 0;
+	bool api = strcmp(source, "api") == 0;
+	bool cpu = strcmp(source, "cpu") == 0 || strcmp(source, "common_cpu") == 0;
+	bool memory = strcmp(source, "memory") == 0 || strcmp(source, "memory_node") == 0
+		|| strcmp(source, "common_memory") == 0;
+	if (!gc && !loop && !api && !cpu && !memory) return;
+
+	std::string out;
+	int64_t time = now();
+	uv_mutex_lock(&mutex);
+	if (!running) {
+		// Stopped since the check above
+	} else if (api) {
+		addHttp(data, size, time, out);
+	} else if (cpu) {
+		addCpu(data, size, time, out);
+	} else if (memory) {
+		addMemory(data, size, time, out);
+	} else {
+		addLines(data, size, time, out, gc);
+	}
+	uv_mutex_unlock(&mutex);
+	flush(out);
+}
+
+void recordHttp(double duration) {
+	if (!running) return;
+	std::string out;
+	int64_t time = now();
+	uv_mutex_lock(&mutex);
+	if (running) {
+		add(HTTP_DURATION, duration, time, out);
+	}
+	uv_mutex_unlock(&mutex);
+	flush(out);
+}
+
+void setRawEvents(bool raw) {
+	rawEvents = raw;
+}
+
+bool suppressRaw(const char* source) {
+	return running && !rawEvents && (strcmp(source, "gc_node") == 0 || strcmp(source, "loop_node") == 0);
+}
+
+} /* namespace rollup */
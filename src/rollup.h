@@ -0,0 +1,50 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+
+
+#ifndef ROLLUP_H_
+#define ROLLUP_H_
+
+/*
+ * Aggregates gc pause, event loop latency, http response time, cpu usage and
+ * physical memory over 1s, 10s and 1m windows as the data is pushed, so
+ * consumers can take a bounded number of summaries instead of every raw event.
+ *
+ * Each closed window with data is emitted on the "rollup" source as
+ *   RollupData,metric,window,start,count;sum;min;max;le:n;...;inf:n
+ * with the histogram in the format of plugins/node/common/histogram.h.
+ *
+ * record() may be called from any thread; start() and stop() must be called
+ * on the event loop thread.
+ */
+namespace rollup {
+
+	typedef void (*Emitter)(const char* source, const char* data, unsigned int size);
+
+	void start(Emitter emitter);
+	void stop();
+	void record(const char* source, const char* data, unsigned int size);
+
+	// For http response times recorded without an api event, see httpsummary.h
+	void recordHttp(double duration);
+
+	// When raw events are off, the gc_node and loop_node data that has been
+	// rolled up is not passed on to JavaScript
+	void setRawEvents(bool raw);
+	bool suppressRaw(const char* source);
+
+} /* namespace rollup */
+#endif /* ROLLUP_H_ */
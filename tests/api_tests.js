@@ -115,6 +115,13 @@ tap.test('Memory Data', function(t) {
     t.ok(memData.physical_free === -1 || memData.physical_free >= 0, 'Contains a valid free physical memory');
 
     t.ok(memData.physical_used === -1 || memData.physical_used >= 0, 'Contains a valid used physical memory', memData);
+
+    if (process.platform === 'linux') {
+      t.ok(isInteger(memData.pss), 'PSS is an integer');
+      t.ok(isInteger(memData.cgroup_limit), 'cgroup limit is an integer');
+      t.ok(memData.host_total === -1 || memData.physical_total <= memData.host_total,
+        'Total memory is no more than the host total');
+    }
     t.end();
   });
 });
@@ -223,6 +230,86 @@ tap.test('Eventloop Data', function(t) {
   });
 });
 
+tap.test('Rollup Data', function(t) {
+  app.appmetrics.enable('rollups');
+  var memory = null;
+  monitor.on('rollup', function onRollup(rollup) {
+    if (rollup.metric === 'memory.physical') memory = rollup;
+    if (rollup.metric !== 'loop.maximum' || memory === null) return;
+    monitor.removeListener('rollup', onRollup);
+    app.appmetrics.disable('rollups');
+    t.ok(memory.minimum > 0, 'Memory is rolled up in MB');
+    t.ok([1000, 10000, 60000].indexOf(rollup.window) !== -1, 'Window is 1s, 10s or 1m');
+    t.equal(rollup.time % rollup.window, 0, 'Window start is aligned');
+    t.ok(rollup.count > 0, 'Contains a positive count');
+    t.ok(rollup.minimum <= rollup.average && rollup.average <= rollup.maximum, 'Average is within minimum and maximum');
+    var total = rollup.buckets.reduce(function(sum, bucket) {
+      return sum + bucket.count;
+    }, 0);
+    t.equal(total, rollup.count, 'Bucket counts add up to the count');
+    t.end();
+  });
+});
+
+tap.test('Allocation Data', function(t) {
+  // Kept alive, as the sampling heap profiler only reports live objects
+  var retained = [];
+  function allocateBeforeReconfigure() {
+    for (var i = 0; i < 1000; i++) {
+      retained.push({ index: i, text: 'allocation ' + i });
+    }
+  }
+  function hasSite(alloc) {
+    return alloc.sites.some(function(site) {
+      return site.name === 'allocateBeforeReconfigure';
+    });
+  }
+
+  app.appmetrics.setConfig('allocation', { sampleInterval: 128, interval: 200 });
+  app.appmetrics.enable('allocation');
+  allocateBeforeReconfigure();
+  monitor.on('allocation', function onFirst(alloc) {
+    if (!hasSite(alloc)) return;
+    monitor.removeListener('allocation', onFirst);
+    t.ok(isReasonableTimestamp(alloc.time), 'time contains current year');
+    t.ok(alloc.sites.every(function(site) {
+      return site.totalSize >= site.selfSize;
+    }), 'Total sizes include the self size');
+
+    // Changing only the report interval must not restart the sampler and lose the profile
+    app.appmetrics.setConfig('allocation', { interval: 100 });
+    setTimeout(function() {
+      monitor.once('allocation', function(next) {
+        app.appmetrics.disable('allocation');
+        t.ok(hasSite(next), 'Sites sampled before the interval change are still reported');
+        t.ok(retained.length > 0);
+        t.end();
+      });
+    }, 300);
+  });
+});
+
+tap.test('Emitted Data', function(t) {
+  var received = [];
+  var onMysql = function(data) {
+    received.push(data);
+  };
+  monitor.on('mysql', onMysql);
+  app.appmetrics.emitMany('mysql', [{ time: 1, query: 'a' }, { time: 2, query: 'b' }]);
+  monitor.removeListener('mysql', onMysql);
+  t.same(received, [{ time: 1, query: 'a' }, { time: 2, query: 'b' }], 'An event is raised for each item');
+  t.doesNotThrow(function() {
+    app.appmetrics.nativeEmit('custom', '{"time":1}');
+    app.appmetrics.nativeEmitMany('custom', ['{"time":2}', '{"time":3}']);
+    // Larger than the reused buffer is kept at
+    app.appmetrics.nativeEmit('custom', JSON.stringify({ time: 4, data: new Array(100000).join('x') }));
+  }, 'Strings can be emitted');
+  t.throws(function() {
+    app.appmetrics.nativeEmit('custom', Buffer.from('{"time":5}'));
+  }, 'Other data is rejected');
+  t.end();
+});
+
 monitor.once('initialized', function() {
   tap.test('Environment Data', function(t) {
     var nodeEnv = monitor.getEnvironment();
@@ -0,0 +1,128 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+'use strict';
+var tap = require('tap');
+var aspect = require('../lib/aspect.js');
+var Probe = require('../lib/probe.js');
+
+function Base() {}
+Base.prototype.inherited = function(value) {
+  return 'inherited ' + value;
+};
+
+// own is set on each instance, inherited comes from the prototype chain
+function Target() {
+  this.own = Target.prototype.own;
+}
+Target.prototype = Object.create(Base.prototype);
+Target.prototype.own = function(value) {
+  return 'own ' + value;
+};
+
+// A started probe that counts the calls its wrappers see
+function attachedProbe(target) {
+  var probe = new Probe('test');
+  probe.calls = 0;
+  aspect.attaching(probe, function() {
+    aspect.before(target, ['own', 'inherited'], function() {
+      probe.calls++;
+    });
+  });
+  probe.start();
+  return probe;
+}
+
+tap.test('disabling a probe restores the original methods', function(t) {
+  var original = Target.prototype.own;
+  var target = new Target();
+  var probe = attachedProbe(target);
+  t.equal(probe.patches.length, 2, 'the patches are recorded against the probe');
+  t.notEqual(target.own, original, 'own method wrapped');
+  t.ok(target.hasOwnProperty('inherited'), 'inherited method wrapped on the target');
+  t.equal(target.own(1), 'own 1');
+  t.equal(target.inherited(2), 'inherited 2');
+  t.equal(probe.calls, 2);
+
+  probe.disable();
+  t.ok(target.hasOwnProperty('own'), 'own method kept');
+  t.equal(target.own, original, 'own method restored');
+  t.notOk(target.hasOwnProperty('inherited'), 'inherited method deleted from the target');
+  t.equal(target.inherited, Base.prototype.inherited, 'the inherited method is found again');
+  target.own(1);
+  target.inherited(2);
+  t.equal(probe.calls, 2, 'no calls seen while disabled');
+  t.end();
+});
+
+tap.test('enabling a probe reinstalls its wrappers', function(t) {
+  var target = new Target();
+  var probe = attachedProbe(target);
+  var wrappers = probe.patches.map(function(patch) {
+    return patch.wrapper;
+  });
+  probe.disable();
+  probe.enable();
+  t.equal(target.own, wrappers[0], 'own method wrapped again');
+  t.equal(target.inherited, wrappers[1], 'inherited method wrapped again');
+  t.equal(target.own(1), 'own 1');
+  t.equal(target.inherited(2), 'inherited 2');
+  t.equal(probe.calls, 2);
+
+  probe.stop();
+  t.notOk(target.hasOwnProperty('inherited'), 'stopping takes the wrappers out too');
+  probe.start();
+  t.ok(target.hasOwnProperty('inherited'), 'and starting puts them back');
+  t.end();
+});
+
+tap.test('a wrapper wrapped over by something else passes calls through', function(t) {
+  var target = new Target();
+  var probe = attachedProbe(target);
+  var ours = target.own;
+  var otherCalls = 0;
+  target.own = function(value) {
+    otherCalls++;
+    return ours.call(this, value);
+  };
+  var theirs = target.own;
+
+  probe.disable();
+  t.equal(target.own, theirs, 'the other wrapper is left in place');
+  t.equal(target.own(1), 'own 1', 'calls still reach the original');
+  t.equal(otherCalls, 1);
+  t.equal(probe.calls, 0, 'the inactive wrapper does nothing');
+
+  probe.enable();
+  t.equal(target.own, theirs, 'the other wrapper is not replaced');
+  t.equal(target.own(2), 'own 2');
+  t.equal(probe.calls, 1, 'the wrapper is active again');
+  t.end();
+});
+
+tap.test('patches made outside of attaching are always active', function(t) {
+  var target = new Target();
+  var calls = 0;
+  aspect.before(target, 'own', function() {
+    calls++;
+  });
+  var probe = new Probe('test');
+  probe.start();
+  probe.disable();
+  target.own(1);
+  t.equal(calls, 1);
+  t.equal(probe.patches.length, 0);
+  t.end();
+});
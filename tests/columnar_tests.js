@@ -0,0 +1,119 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+'use strict';
+
+var app = require('./test_app');
+var fs = require('fs');
+var path = require('path');
+var ColumnarReader = require('../lib/columnar-reader.js');
+var appmetrics = app.appmetrics;
+var outputDir = path.join(process.cwd(), 'columnartestoutput' + Date.now());
+
+// Record in the columnar format, producing output in 'outputDir'
+appmetrics.configure({
+  'com.ibm.diagnostics.healthcenter.headless': 'on',
+  'com.ibm.diagnostics.healthcenter.headless.format': 'columnar',
+  'com.ibm.diagnostics.healthcenter.headless.output.directory': outputDir,
+});
+var startTime = Date.now();
+app.start();
+
+// http events reach the recording as api data
+var http = require('http');
+var REQUESTS = 20;
+var server = http.createServer(function(req, res) {
+  res.end('ok');
+});
+server.listen(0, function() {
+  var sent = 0;
+  (function next() {
+    if (sent++ === REQUESTS) return server.close();
+    http.get({ port: server.address().port, path: '/columnar/' + sent }, function(res) {
+      res.resume();
+      res.on('end', next);
+    });
+  })();
+});
+
+var tap = require('tap');
+
+if (process.platform === 'os390') {
+  tap.plan(0);
+  cleanUp();
+} else {
+  tap.plan(1); // NOTE: This needs to be updated when tests are added/removed
+
+  tap.test('Columnar recording can be queried by source and time', function(t) {
+    setTimeout(function() {
+      // Stopping the agent writes the index
+      app.endRun();
+      var files = fs.readdirSync(outputDir).filter(function(file) {
+        return /\.amc$/.test(file);
+      });
+      t.equal(files.length, 1, 'one .amc file written');
+      var reader = new ColumnarReader(path.join(outputDir, files[0]));
+      t.ok(reader.complete, 'recording has an index');
+      t.notEqual(reader.sources().indexOf('memory'), -1, 'memory data recorded');
+
+      var rows = reader.query('memory');
+      t.ok(rows.length > 0, 'memory rows returned');
+      rows.forEach(function(row) {
+        t.equal(row.source, 'memory');
+        t.ok(row.time >= startTime && row.time <= Date.now(), 'row time in range');
+      });
+      t.match(ColumnarReader.line(rows[0]), /^MemorySource,\d+,/, 'line rebuilt');
+
+      var from = rows[rows.length - 1].time;
+      reader.query(null, from).forEach(function(row) {
+        t.ok(row.time >= from, 'query honours the start time');
+      });
+      t.same(reader.query('memory', 0, startTime - 1), [], 'no rows before recording started');
+
+      // Each api topic is one series, however many events there are
+      var apiSeries = reader.list().filter(function(series) {
+        return series.source === 'api';
+      });
+      var httpSeries = apiSeries.filter(function(series) {
+        return series.name === 'http';
+      });
+      t.equal(httpSeries.length, 1, 'one series for http events');
+      t.equal(httpSeries[0].columns, 1, 'the event JSON is one column');
+      t.ok(apiSeries.length < REQUESTS, 'the number of api series does not grow with the events');
+      var httpRows = reader.query('api').filter(function(row) {
+        return row.name === 'http';
+      });
+      t.ok(httpRows.length >= REQUESTS, 'every http event recorded');
+      var line = ColumnarReader.line(httpRows[0]);
+      t.match(line, /^http:\{/, 'api line rebuilt');
+      t.ok(JSON.parse(line.substring(5)).url, 'the event JSON is kept whole');
+      reader.close();
+      t.end();
+    }, 10000);
+  });
+
+  tap.tearDown(function() {
+    cleanUp();
+  });
+}
+
+function cleanUp() {
+  if (fs.existsSync(outputDir)) {
+    fs.readdirSync(outputDir).forEach(function(file) {
+      fs.unlinkSync(path.join(outputDir, file));
+    });
+    fs.rmdirSync(outputDir);
+  }
+}
@@ -31,11 +31,16 @@ function testFuncCall(test) {
     var heapSnapshotFile = 'heapdump-*.heapsnapshot';
     shelljs.rm('-f', heapSnapshotFile);
 
-    function waitForHeapdump(err, filename) {
+    function waitForHeapdump(err, filename, stats) {
       var files = shelljs.ls(heapSnapshotFile);
       test.equals(err, null);
       test.equals(files.length, 1);
       test.equals(filename, files[0]);
+      test.ok(stats.duration >= 0, 'duration is reported');
+      if (stats.mode === 'fork') {
+        test.equals(stats.exitCode, 0, 'child exited cleanly');
+        test.ok(stats.maxRSS > 0, 'child peak RSS is reported');
+      }
       server.close();
       test.end();
     }
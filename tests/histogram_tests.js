@@ -0,0 +1,149 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+'use strict';
+var tap = require('tap');
+var appmetrics = require('../');
+
+function entries(histogram) {
+  return Object.keys(histogram).map(function(name) {
+    return { name: name, count: histogram[name].count, size: histogram[name].size };
+  });
+}
+
+function isDescending(list, field) {
+  for (var i = 1; i < list.length; i++) {
+    if (list[i][field] > list[i - 1][field]) return false;
+  }
+  return true;
+}
+
+tap.test('getObjectHistogram returns every type unsorted by default', function(t) {
+  var all = entries(appmetrics.getObjectHistogram());
+  t.ok(all.length > 2, 'several types');
+  t.ok(
+    all.some(function(entry) {
+      return entry.name === '(string)';
+    }),
+    'strings are reported as (string)'
+  );
+  all.forEach(function(entry) {
+    t.ok(entry.count > 0 && entry.size >= 0, entry.name + ' has a count and size');
+  });
+  t.end();
+});
+
+tap.test('getObjectHistogram sorts by size or count and keeps the top limit', function(t) {
+  var bySize = entries(appmetrics.getObjectHistogram({ sortBy: 'size' }));
+  t.ok(isDescending(bySize, 'size'), 'largest size first');
+  var byCount = entries(appmetrics.getObjectHistogram({ sortBy: 'count', limit: 5 }));
+  t.equal(byCount.length, 5, 'only the top 5 are returned');
+  t.ok(isDescending(byCount, 'count'), 'largest count first');
+  var limited = entries(appmetrics.getObjectHistogram({ limit: 3 }));
+  t.equal(limited.length, 3, 'a limit on its own sorts by size');
+  t.ok(isDescending(limited, 'size'));
+  t.ok(entries(appmetrics.getObjectHistogram({ limit: 0 })).length > 3, 'a limit of 0 returns every type');
+  t.end();
+});
+
+tap.test('getObjectHistogram rejects invalid options', function(t) {
+  t.throws(function() {
+    appmetrics.getObjectHistogram('size');
+  }, TypeError);
+  t.throws(function() {
+    appmetrics.getObjectHistogram({ sortBy: 'name' });
+  }, RangeError);
+  [NaN, Infinity, -1, 1.5, '5'].forEach(function(limit) {
+    t.throws(
+      function() {
+        appmetrics.getObjectHistogram({ limit: limit });
+      },
+      RangeError,
+      'limit ' + limit + ' is rejected'
+    );
+  });
+  t.end();
+});
+
+tap.test('histogramSession flags types that grow for window samples', function(t) {
+  function LeakingType() {}
+  var retained = [];
+  function grow() {
+    for (var i = 0; i < 100; i++) retained.push(new LeakingType());
+  }
+  function find(changes) {
+    return changes.filter(function(change) {
+      return change.name === 'LeakingType';
+    })[0];
+  }
+
+  var session = appmetrics.histogramSession({ window: 2, sortBy: 'count' });
+  grow();
+  t.same(session.sample(), [], 'the first sample is the baseline');
+
+  grow();
+  var change = find(session.sample());
+  t.ok(change, 'a growing type is reported');
+  t.equal(change.count, 200);
+  t.equal(change.countDelta, 100);
+  t.ok(change.sizeDelta > 0);
+  t.equal(change.growth, 1);
+  t.equal(change.suspect, false, 'not a suspect within the window');
+
+  grow();
+  var changes = session.sample();
+  change = find(changes);
+  t.equal(change.growth, 2);
+  t.equal(change.suspect, true, 'a suspect once it has grown for the window');
+  t.equal(changes[0].suspect, true, 'suspects are listed first');
+
+  change = find(session.sample());
+  t.ok(change === undefined || (change.growth === 0 && !change.suspect), 'growth resets when the count stops growing');
+
+  retained = [];
+  change = find(session.sample());
+  t.ok(change, 'a collected type is reported');
+  t.equal(change.count, 0);
+  t.equal(change.countDelta, -300);
+  t.notOk(find(session.sample()), 'and only once');
+
+  grow();
+  session.reset();
+  t.same(session.sample(), [], 'reset starts a new baseline');
+  t.ok(retained.length > 0);
+  t.end();
+});
+
+tap.test('histogramSession applies its limit and rejects invalid options', function(t) {
+  var session = appmetrics.histogramSession({ limit: 2 });
+  session.sample();
+  var garbage = [];
+  for (var i = 0; i < 1000; i++) garbage.push({ index: i }, [i], new Date(i));
+  t.ok(session.sample().length <= 2, 'no more than limit changes');
+  t.ok(garbage.length > 0);
+  [0, NaN, Infinity, 0.5].forEach(function(window) {
+    t.throws(
+      function() {
+        appmetrics.histogramSession({ window: window });
+      },
+      RangeError,
+      'window ' + window + ' is rejected'
+    );
+  });
+  t.throws(function() {
+    appmetrics.HistogramSession();
+  }, 'must be called with new');
+  t.end();
+});
@@ -0,0 +1,117 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+'use strict';
+
+var app = require('./test_app');
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+var history = require('../lib/history.js');
+var appmetrics = app.appmetrics;
+var historyDir = path.join(os.tmpdir(), 'appmetrics-history-test-' + process.pid);
+
+appmetrics.configure({
+  'com.ibm.diagnostics.healthcenter.mqtt': 'off',
+  'com.ibm.diagnostics.healthcenter.history': 'on',
+  'com.ibm.diagnostics.healthcenter.history.directory': historyDir,
+});
+var startTime = Date.now();
+app.start();
+
+var tap = require('tap');
+
+tap.plan(4); // NOTE: This needs to be updated when tests are added/removed
+
+tap.test('history() returns events raised before monitor() was called', function(t) {
+  setTimeout(function() {
+    var memory = appmetrics.history('memory');
+    t.ok(memory.length > 0, 'memory history kept');
+    memory.forEach(function(event) {
+      t.ok(event.physical > 0, 'memory event decoded');
+      t.ok(event.time >= startTime - 1000, 'event time set');
+    });
+    var loop = appmetrics.history('loop');
+    loop.forEach(function(event) {
+      t.type(event.minimum, 'number', 'loop event decoded');
+    });
+    t.end();
+  }, 6000);
+});
+
+tap.test('history() honours the time range', function(t) {
+  var all = appmetrics.history('memory');
+  var last = all[all.length - 1];
+  // The range is compared with when the data arrived, which is at or after the sample time
+  var recent = appmetrics.history('memory', last.time);
+  t.ok(recent.length >= 1 && recent.length <= all.length, 'events from the start time');
+  t.same(appmetrics.history('memory', 0, startTime - 60000), [], 'nothing before the process started');
+  t.throws(function() {
+    appmetrics.history('profiling');
+  }, 'only kept for some types');
+  t.end();
+});
+
+tap.test('history files can be read after the process has gone', function(t) {
+  var files = fs.readdirSync(historyDir).filter(function(file) {
+    return /-memory\.ring$/.test(file);
+  });
+  t.ok(files.length > 0, 'memory ring file written');
+  var records = history.readFile(path.join(historyDir, files[0]), startTime);
+  t.ok(records.length > 0, 'records read from the file');
+  t.match(records[0].topic, /memory/, 'record topic');
+  if (process.platform !== 'win32') {
+    t.equal(fs.statSync(historyDir).mode & 0o777, 0o700, 'directory only readable by the user');
+    t.equal(fs.statSync(path.join(historyDir, files[0])).mode & 0o777, 0o600, 'ring only readable by the user');
+  }
+  t.end();
+});
+
+tap.test('http history is kept without headers', function(t) {
+  var http = require('http');
+  var server = http.createServer(function(req, res) {
+    res.setHeader('Set-Cookie', 'session=secret');
+    res.end('ok');
+  });
+  server.listen(0, function() {
+    var options = { port: server.address().port, path: '/history', headers: { Cookie: 'session=secret' } };
+    http.get(options, function(res) {
+      res.resume();
+      res.on('end', function() {
+        server.close();
+        // http events are sent with the next api payload
+        setTimeout(function() {
+          var events = appmetrics.history('http').filter(function(event) {
+            return event.url === '/history';
+          });
+          t.ok(events.length > 0, 'http event kept');
+          events.forEach(function(event) {
+            t.notOk('header' in event, 'response headers dropped');
+            t.notOk('requestHeader' in event, 'request headers dropped');
+          });
+          t.end();
+        }, 3000);
+      });
+    });
+  });
+});
+
+tap.tearDown(function() {
+  app.endRun();
+  fs.readdirSync(historyDir).forEach(function(file) {
+    fs.unlinkSync(path.join(historyDir, file));
+  });
+  fs.rmdirSync(historyDir);
+});
@@ -0,0 +1,40 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+'use strict';
+var tap = require('tap');
+var fs = require('fs');
+var path = require('path');
+var probeFiles = require('../lib/probe-files.js');
+var probesDir = path.join(__dirname, '..', 'probes');
+
+tap.test('every probe is listed under the name of the module it instruments', function(t) {
+  fs.readdirSync(probesDir).forEach(function(file) {
+    if (!/-probe\.js$/.test(file) || file === 'trace-probe.js') return;
+    var probe = new (require(path.join(probesDir, file)))();
+    var files = probeFiles.get(probe.name) || [];
+    t.notEqual(files.indexOf(file), -1, file + ' is listed under ' + probe.name);
+  });
+  t.end();
+});
+
+tap.test('every listed probe exists', function(t) {
+  probeFiles.forEach(function(files, name) {
+    files.forEach(function(file) {
+      t.ok(fs.existsSync(path.join(probesDir, file)), file + ' for ' + name + ' exists');
+    });
+  });
+  t.end();
+});
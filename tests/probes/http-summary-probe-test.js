@@ -0,0 +1,77 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ ******************************************************************************/
+'use strict';
+
+var appmetrics = require('../../');
+var monitor = appmetrics.monitor();
+var server = require('../test_http_server').server;
+var http = require('http');
+
+var tap = require('tap');
+
+tap.plan(2);
+
+tap.tearDown(function() {
+  server.close();
+});
+
+var httpEvents = 0;
+monitor.on('http', function(data) {
+  httpEvents++;
+});
+
+monitor.enable('http-summary', { interval: 1000 });
+
+tap.test('HTTP summary event', function(t) {
+  monitor.on('http-summary', function listener(data) {
+    if (data.url !== '/summary') return;
+    monitor.removeListener('http-summary', listener);
+    t.equals(data.method, 'GET', 'Should report GET as HTTP request method');
+    t.equals(data.interval, 1000, 'Should report the interval');
+    t.equals(data.count, 3, 'Should count every request');
+    t.same(data.statusCodes, { '200': 3 }, 'Should count the status codes');
+    t.ok(data.minimum <= data.average && data.average <= data.maximum, 'average is between minimum and maximum');
+    var total = data.buckets.reduce(function(sum, bucket) {
+      return sum + bucket.count;
+    }, 0);
+    t.equals(total, data.count, 'bucket counts add up to the count');
+    t.equals(httpEvents, 0, 'Should not emit per-request events');
+    t.end();
+  });
+});
+
+tap.test('HTTP events can still be asked for', function(t) {
+  monitor.setConfig('http-summary', { events: true });
+  http.get(`http://localhost:${server.address().port}/events`, function(res) {
+    res.resume();
+    res.on('end', function() {
+      setImmediate(function() {
+        t.equals(httpEvents, 1, 'Should emit the per-request event');
+        monitor.disable('http-summary');
+        t.end();
+      });
+    });
+  });
+});
+
+var pending = 3;
+function get() {
+  http.get(`http://localhost:${server.address().port}/summary?query=string`, function(res) {
+    res.resume();
+    if (--pending > 0) get();
+  });
+}
+get();
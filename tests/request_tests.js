@@ -0,0 +1,222 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+'use strict';
+var tap = require('tap');
+var vm = require('vm');
+var appmetrics = require('../');
+var request = require('../lib/request.js');
+var timer = require('../lib/timer.js');
+var Probe = require('../lib/probe.js');
+
+// Collect the request events raised by lib/request.js without starting the agent
+var emitted = [];
+var emit = appmetrics.emit;
+appmetrics.emit = function(topic, data) {
+  if (topic === 'request') emitted.push(data);
+};
+
+tap.tearDown(function() {
+  appmetrics.emit = emit;
+});
+
+function rootRequest(name, context) {
+  var req = request.startRequest('test', name, true);
+  req.stop(context);
+  return req;
+}
+
+tap.test('stopped requests are reused when recycle is set', function(t) {
+  request.setConfig({ recycle: true });
+  var first = rootRequest('first');
+  var second = request.startRequest('test', 'second', true);
+  t.equal(second, first, 'request taken from the pool');
+  t.equal(second.name, 'second');
+  t.equal(second.children.length, 0);
+  second.stop();
+  request.setConfig({ recycle: false });
+  var third = rootRequest('third');
+  t.notEqual(rootRequest('fourth'), third, 'not reused with recycle: false');
+  request.setConfig({ recycle: undefined });
+  t.end();
+});
+
+tap.test('a probe timer is not pooled with its request', function(t) {
+  request.setConfig({ recycle: true });
+  var probeTimer = timer.start();
+  var req = request.startRequest('test', 'probe', true, probeTimer);
+  req.stop();
+  probeTimer.stop();
+  var duration = probeTimer.timeDelta;
+  var next = request.startRequest('test', 'next', true);
+  t.notEqual(next.timer, probeTimer, 'the probe timer is not handed out again');
+  t.equal(probeTimer.timeDelta, duration, 'the probe timer is unchanged');
+  next.stop();
+  request.setConfig({ recycle: undefined });
+  t.end();
+});
+
+tap.test('ending a request twice does not stop a reused request', function(t) {
+  request.setConfig({ recycle: true });
+  var probe = new Probe('test');
+  probe.requestStart = function(probeData) {
+    probeData.req = request.startRequest('test', 'probed', true);
+  };
+  probe.requestEnd = function(probeData) {
+    if (probeData.req) probeData.req.stop();
+  };
+  probe.enableRequests();
+  probe.start();
+  var probeData = {};
+  probe.requestProbeStart(probeData);
+  probe.requestProbeEnd(probeData);
+  t.equal(probeData.req, undefined, 'the probe drops the request');
+  var next = request.startRequest('test', 'next', true);
+  probe.requestProbeEnd(probeData);
+  t.ok(next.active, 'the reused request is still running');
+  next.stop();
+  probe.stop();
+  request.setConfig({ recycle: undefined });
+  t.end();
+});
+
+// A root request that took duration ms, with an already stopped timer
+function timedRequest(name, duration, context) {
+  var requestTimer = timer.start();
+  requestTimer.timeDelta = duration;
+  var req = request.startRequest('test', name, true, requestTimer);
+  req.stop(context);
+  return req;
+}
+
+function emittedNames() {
+  return emitted.map(function(data) {
+    return data.name;
+  });
+}
+
+tap.test('sampleRate 0 builds no tree but keeps the context', function(t) {
+  request.setConfig({ sampleRate: 0, recycle: false });
+  emitted.length = 0;
+  var root = request.startRequest('test', 'unsampled', true);
+  t.notOk(root.children, 'no request tree is built');
+  setImmediate(function() {
+    var child = request.startMethod('child');
+    t.notOk(child.children, 'requests started within it are not built either');
+    child.stop();
+    root.stop();
+    t.same(emitted, [], 'nothing is emitted');
+    request.setConfig({ sampleRate: 1 });
+    var sampled = request.startRequest('test', 'sampled', true);
+    t.ok(Array.isArray(sampled.children), 'sampled requests are built again');
+    sampled.stop();
+    t.same(emittedNames(), ['sampled']);
+    request.setConfig({ recycle: undefined });
+    t.end();
+  });
+});
+
+tap.test('keepSlowest emits the slowest requests at the end of the interval', function(t) {
+  request.setConfig({ keepSlowest: 2, keepInterval: 50, recycle: false });
+  emitted.length = 0;
+  timedRequest('a', 5);
+  timedRequest('b', 30);
+  timedRequest('c', 1);
+  timedRequest('d', 20);
+  t.same(emitted, [], 'nothing is emitted before the interval ends');
+  setTimeout(function() {
+    t.same(emittedNames().sort(), ['b', 'd'], 'the two slowest are emitted');
+    request.setConfig({ keepSlowest: 0, recycle: undefined });
+    t.end();
+  }, 100);
+});
+
+tap.test('failed requests are emitted immediately', function(t) {
+  request.setConfig({ keepSlowest: 1, keepInterval: 60000, recycle: false });
+  emitted.length = 0;
+  timedRequest('slow', 100);
+  timedRequest('error', 1, { error: new Error('failed') });
+  timedRequest('status', 1, { statusCode: 503 });
+  t.same(emittedNames(), ['error', 'status'], 'failures are not held back');
+  request.setConfig({ keepSlowest: 0 });
+  t.same(emittedNames(), ['error', 'status', 'slow'], 'kept requests are emitted when keepSlowest is cleared');
+  request.setConfig({ recycle: undefined });
+  t.end();
+});
+
+tap.test('changing keepInterval emits the kept requests', function(t) {
+  request.setConfig({ keepSlowest: 2, keepInterval: 60000, recycle: false });
+  emitted.length = 0;
+  timedRequest('first', 10);
+  request.setConfig({ keepInterval: 30000 });
+  t.same(emittedNames(), ['first'], 'kept requests are emitted on the change');
+  timedRequest('second', 10);
+  request.setConfig({ keepInterval: NaN });
+  t.same(emittedNames(), ['first', 'second'], 'an invalid interval falls back to the default');
+  timedRequest('third', 10);
+  request.setConfig({ keepInterval: 10000 });
+  t.same(emittedNames(), ['first', 'second'], 'the default interval is already in use');
+  request.setConfig({ keepSlowest: 0, recycle: undefined });
+  t.same(emittedNames(), ['first', 'second', 'third']);
+  t.end();
+});
+
+// Frames from files under appmetrics are dropped, so the stacks come from code with another file name
+var app = vm.runInThisContext(
+  [
+    '(function(request) {',
+    '  function run() { var req = request.startRequest("test", "frames", true); req.stop(); return req; }',
+    '  function Handler() { this.req = run(); }',
+    '  var api = { handle: function() { return run(); } };',
+    '  var anonymous = (function(f) { return f; })(function() { return run(); });',
+    '  return { construct: function() { return new Handler().req; }, method: api.handle, anonymous: anonymous };',
+    '})',
+  ].join('\n'),
+  { filename: '/srv/app/server.js' }
+)(request);
+
+tap.test('stacks are formatted as at type.function(file:line) when read', function(t) {
+  request.setConfig({ minClockStack: 0, recycle: false });
+  var method = app.method.call({ handle: app.method });
+  var construct = app.construct();
+  // Called without a receiver, which V8 would otherwise name it after
+  var anonymous = (0, app.anonymous)();
+  request.setConfig({ minClockStack: -1, recycle: undefined });
+
+  t.equal(method.formattedStack, undefined, 'not formatted until read');
+  var lines = method.stack.split('\n');
+  t.equal(lines[0], 'at <module>.run(/srv/app/server.js:2)');
+  t.equal(lines[1], 'at Object.handle(/srv/app/server.js:4)');
+  t.equal(method.formattedStack, method.stack, 'formatted once');
+  t.equal(construct.stack.split('\n')[1], 'at <module>.new Handler(/srv/app/server.js:3)', 'constructor');
+  t.equal(anonymous.stack.split('\n')[1], 'at <module>.<root>(/srv/app/server.js:5)', 'no function name');
+
+  var frames = method.getStackFrames();
+  t.same(frames[1], {
+    functionName: 'handle',
+    typeName: 'Object',
+    fileName: '/srv/app/server.js',
+    lineNumber: 4,
+    columnNumber: 43,
+  });
+  frames[0].functionName = 'changed';
+  t.equal(method.getStackFrames()[0].functionName, 'run', 'frames are copies');
+  t.equal(anonymous.stack.split('\n')[0], 'at <module>.run(/srv/app/server.js:2)', 'shared frames are unchanged');
+
+  method.stack = 'replaced';
+  t.equal(method.stack, 'replaced', 'stack can be set');
+  t.equal(method.getStackFrames(), undefined);
+  t.end();
+});
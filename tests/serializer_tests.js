@@ -0,0 +1,76 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+'use strict';
+var tap = require('tap');
+var serializer = require('../lib/serializer.js');
+
+// A request tree as carried by request events: children point back at their parent and top
+function requestTree(count) {
+  var root = { name: 'root', children: [], context: { url: '/' } };
+  root.top = root;
+  for (var i = 0; i < count; i++) {
+    root.children.push({ name: 'child' + i, parent: root, top: root, children: [], context: root.context });
+  }
+  return root;
+}
+
+tap.test('serialize replaces repeated references with CIRCULAR ids', function(t) {
+  var json = JSON.parse(serializer.serialize(requestTree(2)));
+  t.equal(json.idCount, 0, 'root has id 0');
+  t.equal(json.top, 'CIRCULAR-0', 'reference to the root');
+  t.equal(json.children[0].idCount, 1, 'ids are given in the order objects are seen');
+  t.equal(json.children[0].parent, 'CIRCULAR-0', 'reference to the parent');
+  t.equal(json.children[0].context.idCount, 2, 'first sight of a shared object');
+  t.equal(json.children[1].context, 'CIRCULAR-2', 'later reference to a shared object');
+  t.end();
+});
+
+tap.test('deserialize restores the references', function(t) {
+  var tree = serializer.deserialize(serializer.serialize(requestTree(3)));
+  t.equal(tree.top, tree, 'root references itself');
+  t.equal(tree.children[2].parent, tree, 'child references its parent');
+  t.equal(tree.children[1].context, tree.context, 'shared object restored');
+  t.notOk('idCount' in tree || 'idCount' in tree.children[0], 'ids removed');
+  t.end();
+});
+
+tap.test('values are written as JSON.stringify would', function(t) {
+  var cycle = [];
+  cycle.push(cycle);
+  var data = serializer.deserialize(
+    serializer.serialize({
+      list: [1, 'text', [2, 3], null, undefined],
+      date: new Date(0),
+      skipped: undefined,
+      fn: function() {},
+      cycle: cycle,
+      text: 'CIRCULAR-notanid',
+    })
+  );
+  t.same(data.list, [1, 'text', [2, 3], null, null], 'array elements kept');
+  t.equal(data.date, '1970-01-01T00:00:00.000Z', 'toJSON used');
+  t.notOk('skipped' in data || 'fn' in data, 'properties without a JSON value left out');
+  t.same(data.cycle, [null], 'cycles through arrays are broken');
+  t.equal(data.text, 'CIRCULAR-notanid', 'strings that are not references kept');
+  t.end();
+});
+
+tap.test('serialize is linear in the number of objects', function(t) {
+  var tree = serializer.deserialize(serializer.serialize(requestTree(50000)));
+  t.equal(tree.children.length, 50000, 'large tree serialized');
+  t.equal(tree.children[49999].parent, tree, 'references in a large tree restored');
+  t.end();
+});
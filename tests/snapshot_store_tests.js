@@ -0,0 +1,152 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+'use strict';
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+var tap = require('tap');
+var SnapshotStore = require('../lib/snapshot-store.js');
+
+var dir = path.join(os.tmpdir(), 'appmetrics-snapshot-store-' + process.pid);
+
+// Stands in for heapdump.writeSnapshot, writing a file of a given size
+function fakeWriter(size) {
+  return function(filename, callback) {
+    fs.writeFileSync(filename, Buffer.alloc(size, 'x'));
+    setImmediate(callback, null, filename);
+    return true;
+  };
+}
+
+function cleanDir() {
+  if (!fs.existsSync(dir)) return;
+  fs.readdirSync(dir).forEach(function(file) {
+    fs.unlinkSync(path.join(dir, file));
+  });
+  fs.rmdirSync(dir);
+}
+
+function writeN(store, n, callback) {
+  if (n === 0) return callback();
+  // distinct timestamps keep the eviction order deterministic
+  setTimeout(function() {
+    store.write('manual', function(err) {
+      if (err) return callback(err);
+      writeN(store, n - 1, callback);
+    });
+  }, 2);
+}
+
+tap.tearDown(cleanDir);
+
+tap.test('snapshot is renamed into place and recorded in the manifest', function(t) {
+  cleanDir();
+  var store = new SnapshotStore(fakeWriter(100), { directory: dir });
+  store.write('manual', function(err, entry) {
+    t.error(err);
+    t.equal(entry.pid, process.pid);
+    t.equal(entry.trigger, 'manual');
+    t.equal(entry.size, 100);
+    t.ok(entry.heapUsed > 0, 'heapUsed is recorded');
+    t.ok(fs.existsSync(path.join(dir, entry.file)), 'snapshot file exists');
+    var leftovers = fs.readdirSync(dir).filter(function(file) {
+      return /\.tmp$/.test(file);
+    });
+    t.same(leftovers, [], 'no temporary files remain');
+    var manifest = JSON.parse(fs.readFileSync(path.join(dir, 'manifest.json'), 'utf8'));
+    t.equal(manifest.snapshots.length, 1);
+    t.equal(manifest.snapshots[0].file, entry.file);
+    t.end();
+  });
+});
+
+tap.test('oldest snapshots are removed beyond maxFiles', function(t) {
+  cleanDir();
+  var store = new SnapshotStore(fakeWriter(10), { directory: dir, maxFiles: 2 });
+  writeN(store, 4, function(err) {
+    t.error(err);
+    var list = store.list();
+    t.equal(list.length, 2);
+    var files = fs.readdirSync(dir).filter(function(file) {
+      return /\.heapsnapshot$/.test(file);
+    });
+    t.equal(files.length, 2, 'only two snapshots on disk');
+    t.ok(list[0].time < list[1].time, 'newest snapshots kept');
+    t.end();
+  });
+});
+
+tap.test('oldest snapshots are removed beyond maxTotalSize', function(t) {
+  cleanDir();
+  var store = new SnapshotStore(fakeWriter(100), { directory: dir, maxFiles: 10, maxTotalSize: 250 });
+  writeN(store, 3, function(err) {
+    t.error(err);
+    t.equal(store.list().length, 2);
+    t.end();
+  });
+});
+
+tap.test('a snapshot larger than maxTotalSize is reported and removed', function(t) {
+  cleanDir();
+  var store = new SnapshotStore(fakeWriter(100), { directory: dir, maxTotalSize: 50 });
+  store.write('manual', function(err) {
+    t.ok(err, 'error reported');
+    t.equal(store.list().length, 0);
+    t.end();
+  });
+});
+
+tap.test('only one snapshot is written at a time', function(t) {
+  cleanDir();
+  var store = new SnapshotStore(fakeWriter(10), { directory: dir });
+  t.equal(store.write('manual'), true);
+  t.equal(store.write('manual', function(err) {
+    t.ok(err, 'second write rejected');
+  }), false);
+  setTimeout(t.end.bind(t), 20);
+});
+
+tap.test('heap threshold triggers are rate limited', function(t) {
+  cleanDir();
+  var writes = 0;
+  var store = new SnapshotStore(function(filename, callback) {
+    writes++;
+    return fakeWriter(10)(filename, callback);
+  }, { directory: dir, heapUsedThreshold: 1000, minInterval: 60000 });
+  store.onGC({ used: 999 });
+  t.equal(writes, 0, 'below threshold');
+  store.onGC({ used: 1000 });
+  t.equal(writes, 1, 'threshold crossed');
+  setTimeout(function() {
+    store.onGC({ used: 2000 });
+    t.equal(writes, 1, 'suppressed within minInterval');
+    t.equal(store.list()[0].trigger, 'threshold');
+    t.end();
+  }, 20);
+});
+
+tap.test('invalid configuration is rejected', function(t) {
+  t.throws(function() {
+    new SnapshotStore(fakeWriter(10), {});
+  }, TypeError);
+  t.throws(function() {
+    new SnapshotStore(fakeWriter(10), { directory: dir, maxFiles: 0 });
+  }, RangeError);
+  t.throws(function() {
+    new SnapshotStore(fakeWriter(10), { directory: dir, maxTotalSize: -1 });
+  }, RangeError);
+  t.end();
+});
@@ -0,0 +1,101 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+'use strict';
+var tap = require('tap');
+var UrlFilter = require('../lib/url-filter.js');
+
+// What testing each filter in turn gives, as the http probes used to
+function sequential(filters, method, url) {
+  var path = url.split(/[?#]/)[0];
+  var identifier = method + ' ' + path;
+  for (var i = 0; i < filters.length; i++) {
+    if (new RegExp(filters[i].pattern).test(identifier)) return filters[i].to;
+  }
+  return path;
+}
+
+tap.test('query and fragment are dropped', function(t) {
+  var filter = new UrlFilter([], { collapseIds: false });
+  t.equal(filter.route('GET', '/a/b?c=1#d'), '/a/b');
+  t.equal(filter.route('GET', '/a/b#d?c=1'), '/a/b');
+  t.equal(filter.route('GET', '/'), '/');
+  t.end();
+});
+
+tap.test('numeric and UUID segments are collapsed', function(t) {
+  var filter = new UrlFilter([]);
+  t.equal(filter.route('GET', '/users/123/orders/4'), '/users/:id/orders/:id');
+  t.equal(filter.route('GET', '/items/0b7d6a4e-2f9c-4c1a-9d3e-5a6b7c8d9e0f?x=1'), '/items/:uuid');
+  t.equal(filter.route('GET', '/v2/page3/123abc'), '/v2/page3/123abc', 'mixed segments are kept');
+  t.equal(new UrlFilter([], { collapseIds: false }).route('GET', '/users/123'), '/users/123');
+  t.end();
+});
+
+tap.test('the first filter in the list to match wins', function(t) {
+  var filters = [
+    { pattern: 'favicon', to: '' },
+    { pattern: '^GET /api/users/[0-9]+$', to: '/api/users/{id}' },
+    { pattern: '^GET /api/', to: '/api/other' },
+    { pattern: '^(GET|POST) /api/orders', to: '/orders' },
+    { pattern: '^POST /(\\w+)/\\1$', to: '/repeated' },
+    { pattern: 'SECRET', to: '/hidden' },
+  ];
+  var filter = new UrlFilter(filters);
+  t.equal(filter.route('GET', '/favicon.ico'), '');
+  t.equal(filter.route('GET', '/api/users/42'), '/api/users/{id}');
+  t.equal(filter.route('GET', '/api/users/42/x'), '/api/other');
+  t.equal(filter.route('GET', '/api/orders'), '/api/other', 'earlier filter beats later prefix');
+  t.equal(filter.route('POST', '/api/orders'), '/orders');
+  t.equal(filter.route('POST', '/a/a'), '/repeated', 'backreferences still work');
+  t.equal(filter.route('POST', '/a/b'), '/a/b');
+  t.equal(filter.route('GET', '/api/users/1/favicon'), '', 'unanchored filter matches anywhere');
+  t.equal(filter.route('PUT', '/users/1'), '/users/:id', 'no filter matches');
+  t.end();
+});
+
+tap.test('filters with flags are honoured', function(t) {
+  var filter = new UrlFilter([{ regex: /^get \/ADMIN/i, to: '/admin' }, { pattern: '^GET /a', to: '/a' }]);
+  t.equal(filter.route('GET', '/admin/x'), '/admin');
+  t.equal(filter.route('GET', '/ab'), '/a');
+  t.end();
+});
+
+tap.test('matches testing filters one by one', function(t) {
+  var filters = [];
+  for (var i = 0; i < 300; i++) {
+    filters.push({ pattern: '^GET /r' + i + '/[a-z]+$', to: '/r' + i });
+    if (i % 50 === 0) filters.push({ pattern: '/r' + i + '/', to: '/any' + i });
+  }
+  filters.push({ pattern: '^(GET|PUT) /r1', to: '/r1x' });
+  var filter = new UrlFilter(filters, { collapseIds: false });
+  var urls = ['/r1/abc', '/r10/abc', '/r100/x?y', '/r299/zz', '/r50/a1', '/r1/9', '/none', '/r150/q'];
+  ['GET', 'PUT'].forEach(function(method) {
+    urls.forEach(function(url) {
+      t.equal(filter.route(method, url), sequential(filters, method, url), method + ' ' + url);
+    });
+  });
+  t.end();
+});
+
+tap.test('recent results are cached up to cacheSize', function(t) {
+  var filter = new UrlFilter([{ pattern: '^GET /c', to: '/c' }], { cacheSize: 2 });
+  filter.route('GET', '/c1');
+  filter.route('GET', '/c2');
+  filter.route('GET', '/c1');
+  filter.route('GET', '/c3');
+  t.same(Array.from(filter.cache.keys()), ['GET /c1', 'GET /c3'], 'least recently used is evicted');
+  t.end();
+});
@@ -0,0 +1,155 @@
+/*******************************************************************************
+ * Copyright 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *******************************************************************************/
+'use strict';
+var crypto = require('crypto');
+var fs = require('fs');
+var os = require('os');
+var path = require('path');
+var tap = require('tap');
+var zlib = require('zlib');
+
+var base = path.join(os.tmpdir(), 'appmetrics-zip-' + process.pid);
+
+var CRC_TABLE = [];
+for (var n = 0; n < 256; n++) {
+  var c = n;
+  for (var k = 0; k < 8; k++) {
+    c = c & 1 ? 0xedb88320 ^ (c >>> 1) : c >>> 1;
+  }
+  CRC_TABLE.push(c >>> 0);
+}
+
+function crc32(buffer) {
+  var crc = 0xffffffff;
+  for (var i = 0; i < buffer.length; i++) {
+    crc = CRC_TABLE[(crc ^ buffer[i]) & 0xff] ^ (crc >>> 8);
+  }
+  return (crc ^ 0xffffffff) >>> 0;
+}
+
+// Reads the archive through its central directory, as unzip tools do
+function readArchive(t, archive) {
+  var end = archive.length - 22;
+  t.equal(archive.readUInt32LE(end), 0x06054b50, 'end of central directory record');
+  var count = archive.readUInt16LE(end + 10);
+  var directorySize = archive.readUInt32LE(end + 12);
+  var position = archive.readUInt32LE(end + 16);
+  t.equal(position + directorySize, end, 'central directory ends at the end record');
+
+  var entries = {};
+  for (var i = 0; i < count; i++) {
+    t.equal(archive.readUInt32LE(position), 0x02014b50, 'central directory header');
+    t.equal(archive.readUInt16LE(position + 10), 8, 'deflated');
+    var crc = archive.readUInt32LE(position + 16);
+    var compressedSize = archive.readUInt32LE(position + 20);
+    var size = archive.readUInt32LE(position + 24);
+    var nameLength = archive.readUInt16LE(position + 28);
+    var offset = archive.readUInt32LE(position + 42);
+    var name = archive.toString('utf8', position + 46, position + 46 + nameLength);
+    position += 46 + nameLength;
+
+    t.equal(archive.readUInt32LE(offset), 0x04034b50, name + ' local header');
+    t.equal(archive.readUInt16LE(offset + 6) & 0x08, 0x08, name + ' has a data descriptor');
+    var dataStart = offset + 30 + archive.readUInt16LE(offset + 26) + archive.readUInt16LE(offset + 28);
+    var data = zlib.inflateRawSync(archive.slice(dataStart, dataStart + compressedSize));
+    var descriptor = dataStart + compressedSize;
+    t.equal(archive.readUInt32LE(descriptor), 0x08074b50, name + ' data descriptor');
+    t.equal(archive.readUInt32LE(descriptor + 4), crc, name + ' descriptor crc');
+    t.equal(archive.readUInt32LE(descriptor + 8), compressedSize, name + ' descriptor compressed size');
+    t.equal(archive.readUInt32LE(descriptor + 12), size, name + ' descriptor size');
+    t.equal(data.length, size, name + ' size');
+    t.equal(crc32(data), crc, name + ' crc');
+    entries[name] = data;
+  }
+  return entries;
+}
+
+function makeDir(name, files) {
+  var dir = path.join(base, name);
+  fs.mkdirSync(dir);
+  for (var file in files) {
+    fs.writeFileSync(path.join(dir, file), files[file]);
+  }
+  return dir;
+}
+
+function checkArchive(t, dir, output, files) {
+  t.notOk(fs.existsSync(dir), 'the directory is removed');
+  var entries = readArchive(t, fs.readFileSync(output));
+  t.same(Object.keys(entries).sort(), Object.keys(files).sort());
+  for (var file in files) {
+    t.ok(entries[file].equals(files[file]), file + ' content');
+  }
+}
+
+function removeAll(dir) {
+  if (!fs.existsSync(dir)) return;
+  fs.readdirSync(dir).forEach(function(file) {
+    var name = path.join(dir, file);
+    if (fs.statSync(name).isDirectory()) {
+      removeAll(name);
+    } else {
+      fs.unlinkSync(name);
+    }
+  });
+  fs.rmdirSync(dir);
+}
+
+// The zip is written by the addon, which isn't built on z/OS
+if (process.platform === 'os390') {
+  tap.plan(0);
+} else {
+  var agent = require('../appmetrics');
+  var files = {
+    empty: Buffer.alloc(0),
+    'text.txt': Buffer.from(new Array(20000).join('appmetrics\n')),
+    // Incompressible and larger than a chunk, so deflate is called repeatedly
+    'random.bin': crypto.randomBytes(200 * 1024),
+  };
+
+  removeAll(base);
+  fs.mkdirSync(base);
+  tap.tearDown(function() {
+    removeAll(base);
+  });
+
+  tap.test('zipDirectorySync writes a valid archive', function(t) {
+    var dir = makeDir('sync', files);
+    var output = path.join(base, 'sync.zip');
+    agent.zipDirectorySync(dir, output);
+    checkArchive(t, dir, output, files);
+    t.end();
+  });
+
+  tap.test('zipDirectory writes a valid archive', function(t) {
+    var dir = makeDir('async', files);
+    var output = path.join(base, 'async.zip');
+    agent.zipDirectory(dir, output, function(err) {
+      t.error(err);
+      checkArchive(t, dir, output, files);
+      t.end();
+    });
+  });
+
+  tap.test('a failed zip leaves the directory and no archive', function(t) {
+    var output = path.join(base, 'missing.zip');
+    t.throws(function() {
+      agent.zipDirectorySync(path.join(base, 'missing'), output);
+    });
+    t.notOk(fs.existsSync(output));
+    t.end();
+  });
+}